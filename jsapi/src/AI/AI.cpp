@@ -17,7 +17,10 @@
 
 #include "AI.hpp"
 #include "strUtils.hpp"
+#include "FetchEngine.hpp"
 #include <Exceptions/NetworkError.hpp>
+#include <Exceptions/AssertFailed.hpp>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <regex>
@@ -29,8 +32,9 @@ AI::AI()
     std::lock_guard<std::mutex> conversationLock(conversationMutex);
 
     conversationManager.loadApiSettings(apiKey, baseUrl, model, maxTokens, temperature, topP, systemPrompt);
+    fallbackEndpoints = conversationManager.loadEndpoints();
 
-    auto conversationsResponse = conversationManager.getConversationList();
+    auto conversationsResponse = conversationManager.getConversationPage(1);
     if (conversationsResponse.empty())
     {
         conversationManager.createConversation("默认对话", conversationId);
@@ -39,14 +43,15 @@ AI::AI()
         currentNodeId = rootNodeId = strUtils::randomId();
         nodeMap[currentNodeId] = std::make_unique<ConversationNode>(
             currentNodeId, ConversationNode::ROLE_SYSTEM, systemPrompt, "");
-        stateLock.unlock();
-        saveConversation();
+        markNew(currentNodeId);
+        onConversationChanged();
     }
     else
     {
         conversationId = conversationsResponse[0].id;
         std::unique_lock<std::shared_mutex> stateLock(stateMutex);
         conversationManager.loadConversation(conversationId, nodeMap, rootNodeId, currentNodeId);
+        onConversationChanged();
     }
 }
 
@@ -56,20 +61,84 @@ ConversationNode *AI::findNode(const std::string &nodeId)
     return (it != nodeMap.end()) ? it->second.get() : nullptr;
 }
 
-std::vector<ConversationNode> AI::getPathFromRoot(const std::string &nodeId)
+// Shared by every AI instance so versions handed to JS stay valid when AI is re-initialized
+static std::atomic<uint64_t> revisionCounter{0};
+
+void AI::touch(ConversationNode *node)
 {
-    std::vector<ConversationNode> path;
-    std::string currentId = nodeId;
-    while (!currentId.empty())
+    if (node)
+        node->version = revision = ++revisionCounter;
+}
+
+void AI::rebuildPath()
+{
+    std::vector<ConversationNode *> path;
+    path.reserve(currentPath.size() + 1);
+    for (ConversationNode *node = findNode(currentNodeId); node; node = findNode(node->parentId))
+        path.push_back(node);
+    std::reverse(path.begin(), path.end());
+    if (path != currentPath)
     {
-        ConversationNode *node = findNode(currentId);
-        if (!node)
-            break;
-        path.push_back(*node);
-        currentId = node->parentId;
+        std::unordered_set<const ConversationNode *> previous(currentPath.begin(), currentPath.end());
+        currentPath.swap(path);
+        pathRevision = revision = ++revisionCounter;
+        // The client may never have been sent nodes that join the path (e.g. after switching
+        // branches), so they count as changed
+        for (ConversationNode *node : currentPath)
+            if (!previous.count(node))
+                node->version = pathRevision;
     }
-    std::reverse(path.begin(), path.end());
-    return path;
+    loadContent(currentPath);
+    evictContent();
+}
+
+void AI::loadContent(const std::vector<ConversationNode *> &nodes)
+{
+    std::vector<std::string> missing;
+    for (const ConversationNode *node : nodes)
+        if (!node->contentLoaded)
+            missing.push_back(node->id);
+    if (!missing.empty())
+    {
+        auto contents = conversationManager.loadContents(missing);
+        for (const auto &nodeId : missing)
+        {
+            ConversationNode *node = findNode(nodeId);
+            auto it = contents.find(nodeId);
+            if (it != contents.end())
+                node->content = std::move(it->second);
+            node->contentLoaded = true;
+        }
+    }
+    for (const ConversationNode *node : nodes)
+        contentCache.touch(node->id, node->content.size());
+}
+
+void AI::evictContent()
+{
+    std::unordered_set<std::string> pathIds;
+    for (const ConversationNode *node : currentPath)
+        pathIds.insert(node->id);
+    // Unsaved content must stay in memory until saveConversation has snapshotted it
+    auto pinned = [&](const std::string &nodeId)
+    { return pathIds.count(nodeId) || newNodeIds.count(nodeId) || dirtyNodeIds.count(nodeId); };
+    for (const auto &nodeId : contentCache.evict(pinned))
+        if (ConversationNode *node = findNode(nodeId))
+        {
+            std::string().swap(node->content);
+            node->contentLoaded = false;
+        }
+}
+
+void AI::onConversationChanged()
+{
+    conversationRevision = revision = ++revisionCounter;
+    for (auto &pair : nodeMap)
+        if (pair.second)
+            pair.second->version = conversationRevision;
+    currentPath.clear();
+    contentCache.clear();
+    rebuildPath();
 }
 
 void AI::addNode(ConversationNode::ROLE role, std::string content)
@@ -79,8 +148,11 @@ void AI::addNode(ConversationNode::ROLE role, std::string content)
     ConversationNode *parent = findNode(currentNodeId);
     if (parent)
         parent->childIds.push_back(nodeId);
+    touch(parent);
     nodeMap[nodeId] = std::make_unique<ConversationNode>(nodeId, role, content, currentNodeId);
+    markNew(nodeId);
     currentNodeId = nodeId;
+    rebuildPath();
     stateLock.unlock();
     saveConversation();
 }
@@ -97,10 +169,13 @@ bool AI::deleteNode(const std::string &nodeId)
         auto it = std::find(parent->childIds.begin(), parent->childIds.end(), nodeId);
         if (it != parent->childIds.end())
             parent->childIds.erase(it);
+        touch(parent);
     }
-    nodeMap.erase(nodeId);
     if (currentNodeId == nodeId)
         currentNodeId = node->parentId;
+    nodeMap.erase(nodeId);
+    markDeleted(nodeId);
+    rebuildPath();
     stateLock.unlock();
     saveConversation();
     return true;
@@ -113,11 +188,131 @@ bool AI::switchNode(const std::string &nodeId)
     if (node)
     {
         currentNodeId = nodeId;
+        rebuildPath();
         return true;
     }
     return false;
 }
 
+bool AI::setPinned(const std::string &nodeId, bool pinned)
+{
+    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+    ConversationNode *node = findNode(nodeId);
+    if (!node)
+        return false;
+    if (node->pinned != pinned)
+    {
+        node->pinned = pinned;
+        markDirty(nodeId);
+        stateLock.unlock();
+        saveConversation();
+    }
+    return true;
+}
+
+ConversationNode *AI::descend(ConversationNode *node, bool lastChild)
+{
+    while (node && !node->childIds.empty())
+    {
+        ConversationNode *child = findNode(lastChild ? node->childIds.back() : node->childIds.front());
+        if (!child)
+            break;
+        node = child;
+    }
+    return node;
+}
+
+bool AI::switchToLeaf(const std::string &nodeId, bool lastChild)
+{
+    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+    ConversationNode *leaf = descend(findNode(nodeId), lastChild);
+    if (!leaf)
+        return false;
+    currentNodeId = leaf->id;
+    rebuildPath();
+    return true;
+}
+
+bool AI::switchSibling(const std::string &nodeId, int offset)
+{
+    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+    ConversationNode *node = findNode(nodeId);
+    if (!node)
+        return false;
+    ConversationNode *parent = findNode(node->parentId);
+    if (!parent)
+        return false;
+    auto it = std::find(parent->childIds.begin(), parent->childIds.end(), nodeId);
+    if (it == parent->childIds.end())
+        return false;
+    long index = (it - parent->childIds.begin()) + offset;
+    if (index < 0 || index >= (long)parent->childIds.size())
+        return false;
+    ConversationNode *leaf = descend(findNode(parent->childIds[index]), false);
+    if (!leaf)
+        return false;
+    currentNodeId = leaf->id;
+    rebuildPath();
+    return true;
+}
+
+std::vector<BranchStep> AI::getBranch()
+{
+    std::shared_lock<std::shared_mutex> stateLock(stateMutex);
+    std::vector<BranchStep> branch;
+    branch.reserve(currentPath.size());
+    const ConversationNode *parent = nullptr;
+    for (const ConversationNode *node : currentPath)
+    {
+        BranchStep step{node->id, 0, 1};
+        if (parent)
+        {
+            auto it = std::find(parent->childIds.begin(), parent->childIds.end(), node->id);
+            step.siblingIndex = it - parent->childIds.begin();
+            step.siblingCount = parent->childIds.size();
+        }
+        branch.push_back(step);
+        parent = node;
+    }
+    return branch;
+}
+
+std::vector<SubtreeEntry> AI::getSubtree(const std::string &nodeId, int maxDepth)
+{
+    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+    ConversationNode *root = findNode(nodeId);
+    if (!root)
+        return {};
+
+    // Depth-first in child order, so a parent always precedes its children
+    std::vector<std::pair<ConversationNode *, int>> nodes;
+    std::vector<std::pair<ConversationNode *, int>> stack = {{root, 0}};
+    while (!stack.empty())
+    {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        nodes.push_back({node, depth});
+        if (maxDepth >= 0 && depth >= maxDepth)
+            continue;
+        for (auto it = node->childIds.rbegin(); it != node->childIds.rend(); ++it)
+            if (ConversationNode *child = findNode(*it))
+                stack.push_back({child, depth + 1});
+    }
+
+    std::vector<ConversationNode *> subtreeNodes;
+    subtreeNodes.reserve(nodes.size());
+    for (const auto &entry : nodes)
+        subtreeNodes.push_back(entry.first);
+    loadContent(subtreeNodes);
+
+    std::vector<SubtreeEntry> subtree;
+    subtree.reserve(nodes.size());
+    for (const auto &entry : nodes)
+        subtree.push_back({*entry.first, entry.second});
+    evictContent();
+    return subtree;
+}
+
 std::vector<std::string> AI::getChildren(const std::string &nodeId)
 {
     std::shared_lock<std::shared_mutex> stateLock(stateMutex);
@@ -130,7 +325,29 @@ std::vector<std::string> AI::getChildren(const std::string &nodeId)
 std::vector<ConversationNode> AI::getCurrentPath()
 {
     std::shared_lock<std::shared_mutex> stateLock(stateMutex);
-    return getPathFromRoot(currentNodeId);
+    std::vector<ConversationNode> path;
+    path.reserve(currentPath.size());
+    for (const ConversationNode *node : currentPath)
+        path.push_back(*node);
+    return path;
+}
+PathChanges AI::getPathChanges(uint64_t sinceVersion)
+{
+    std::shared_lock<std::shared_mutex> stateLock(stateMutex);
+    PathChanges changes;
+    changes.version = revision;
+    changes.reset = sinceVersion < conversationRevision;
+    changes.pathChanged = sinceVersion < pathRevision;
+    if (changes.pathChanged)
+    {
+        changes.path.reserve(currentPath.size());
+        for (const ConversationNode *node : currentPath)
+            changes.path.push_back(node->id);
+    }
+    for (const ConversationNode *node : currentPath)
+        if (node->version > sinceVersion)
+            changes.nodes.push_back(*node);
+    return changes;
 }
 std::string AI::getCurrentNodeId() const
 {
@@ -148,13 +365,90 @@ std::string AI::getConversationId() const
     return conversationId;
 }
 
+void AI::markNew(const std::string &nodeId)
+{
+    ConversationNode *node = findNode(nodeId);
+    touch(node);
+    contentCache.touch(nodeId, node->content.size());
+    newNodeIds.insert(nodeId);
+}
+void AI::markDirty(const std::string &nodeId)
+{
+    ConversationNode *node = findNode(nodeId);
+    touch(node);
+    if (node->contentLoaded)
+        contentCache.touch(nodeId, node->content.size());
+    if (newNodeIds.count(nodeId) == 0)
+        dirtyNodeIds.insert(nodeId);
+}
+void AI::markDeleted(const std::string &nodeId)
+{
+    contentCache.erase(nodeId);
+    dirtyNodeIds.erase(nodeId);
+    if (newNodeIds.erase(nodeId) == 0)
+        deletedNodeIds.insert(nodeId);
+}
+void AI::clearChanges()
+{
+    newNodeIds.clear();
+    dirtyNodeIds.clear();
+    deletedNodeIds.clear();
+}
+
 void AI::saveConversation()
 {
-    std::shared_lock<std::shared_mutex> stateLock(stateMutex);
-    if (!conversationId.empty())
+    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
     {
-        conversationManager.saveConversation(conversationId, nodeMap);
+        std::lock_guard<std::mutex> failedSaveLock(failedSaveMutex);
+        for (const auto &failed : failedSaves)
+        {
+            // The tree of any other conversation is gone, so its changes cannot be replayed
+            if (failed.conversationId != conversationId)
+            {
+                std::cerr << "Dropping unsaved changes of conversation " << failed.conversationId << std::endl;
+                continue;
+            }
+            for (const auto &nodeId : failed.newNodeIds)
+                if (findNode(nodeId))
+                    newNodeIds.insert(nodeId);
+                else
+                    deletedNodeIds.erase(nodeId); // Deleted before it ever reached the database
+            for (const auto &nodeId : failed.dirtyNodeIds)
+                if (findNode(nodeId) && newNodeIds.count(nodeId) == 0)
+                    dirtyNodeIds.insert(nodeId);
+            deletedNodeIds.insert(failed.deletedNodeIds.begin(), failed.deletedNodeIds.end());
+        }
+        failedSaves.clear();
     }
+    if (conversationId.empty() || (newNodeIds.empty() && dirtyNodeIds.empty() && deletedNodeIds.empty()))
+        return;
+
+    std::vector<ConversationNode> insertedNodes, updatedNodes;
+    for (const auto &nodeId : newNodeIds)
+        if (ConversationNode *node = findNode(nodeId))
+            insertedNodes.push_back(*node);
+    for (const auto &nodeId : dirtyNodeIds)
+        if (ConversationNode *node = findNode(nodeId))
+            updatedNodes.push_back(*node);
+    std::vector<std::string> deletedNodes(deletedNodeIds.begin(), deletedNodeIds.end());
+    FailedSave failed{conversationId,
+                      std::vector<std::string>(newNodeIds.begin(), newNodeIds.end()),
+                      std::vector<std::string>(dirtyNodeIds.begin(), dirtyNodeIds.end()),
+                      deletedNodes};
+    clearChanges();
+
+    // Runs on the database thread, which must not wait for stateMutex: the JS
+    // thread can hold it while waiting for a read queued behind this save
+    std::weak_ptr<AI> weakSelf = weak_from_this();
+    conversationManager.saveChanges(conversationId, insertedNodes, updatedNodes, deletedNodes,
+                                    [weakSelf, failed]()
+                                    {
+                                        if (std::shared_ptr<AI> self = weakSelf.lock())
+                                        {
+                                            std::lock_guard<std::mutex> failedSaveLock(self->failedSaveMutex);
+                                            self->failedSaves.push_back(failed);
+                                        }
+                                    });
 }
 
 std::vector<ConversationInfo> AI::getConversationList()
@@ -162,6 +456,16 @@ std::vector<ConversationInfo> AI::getConversationList()
     std::lock_guard<std::mutex> conversationLock(conversationMutex);
     return conversationManager.getConversationList();
 }
+std::vector<ConversationInfo> AI::getConversationPage(size_t limit, const ConversationInfo *after)
+{
+    std::lock_guard<std::mutex> conversationLock(conversationMutex);
+    return conversationManager.getConversationPage(limit, after);
+}
+SearchPage AI::searchMessages(const std::string &query, size_t limit, const SearchCursor *after)
+{
+    // Reads only what has been persisted, so no conversation lock is needed
+    return conversationManager.searchMessages(query, limit, after);
+}
 
 void AI::createConversation(const std::string &title)
 {
@@ -173,11 +477,14 @@ void AI::createConversation(const std::string &title)
         std::unique_lock<std::shared_mutex> stateLock(stateMutex);
         conversationId = newConversationId;
         nodeMap.clear();
+        clearChanges();
 
         std::lock_guard<std::mutex> settingsLock(settingsMutex);
         currentNodeId = rootNodeId = strUtils::randomId();
         nodeMap[currentNodeId] = std::make_unique<ConversationNode>(
             currentNodeId, ConversationNode::ROLE_SYSTEM, systemPrompt, "");
+        markNew(currentNodeId);
+        onConversationChanged();
     }
     saveConversation();
 }
@@ -187,7 +494,9 @@ void AI::loadConversation(const std::string &conversationId)
     std::lock_guard<std::mutex> conversationLock(conversationMutex);
     std::unique_lock<std::shared_mutex> stateLock(stateMutex);
     this->conversationId = conversationId;
+    clearChanges();
     conversationManager.loadConversation(conversationId, nodeMap, rootNodeId, currentNodeId);
+    onConversationChanged();
 }
 
 void AI::deleteConversation(const std::string &conversationId)
@@ -201,16 +510,20 @@ void AI::deleteConversation(const std::string &conversationId)
     std::unique_lock<std::shared_mutex> stateLock(stateMutex);
     if (this->conversationId == conversationId)
     {
-        auto conversations = conversationManager.getConversationList();
+        auto conversations = conversationManager.getConversationPage(1);
         if (!conversations.empty())
         {
             this->conversationId = conversations[0].id;
+            clearChanges();
             conversationManager.loadConversation(this->conversationId, nodeMap, rootNodeId, currentNodeId);
+            onConversationChanged();
         }
         else
         {
             this->conversationId.clear();
             nodeMap.clear();
+            clearChanges();
+            currentPath.clear();
             conversationLock.unlock();
             stateLock.unlock();
             createConversation("默认对话");
@@ -228,11 +541,12 @@ void AI::setSettings(const std::string &apiKey, const std::string &baseUrl,
                      const std::string &model, int maxTokens,
                      double temperature, double topP, std::string systemPrompt)
 {
+    // Saved first so a failed write leaves the settings in use unchanged
+    conversationManager.saveApiSettings(apiKey, baseUrl, model, maxTokens, temperature, topP, systemPrompt);
     std::lock_guard<std::mutex> settingsLock(settingsMutex);
     this->apiKey = apiKey, this->baseUrl = baseUrl;
     this->model = model, this->maxTokens = maxTokens;
     this->temperature = temperature, this->topP = topP, this->systemPrompt = systemPrompt;
-    conversationManager.saveApiSettings(apiKey, baseUrl, model, maxTokens, temperature, topP, systemPrompt);
 }
 SettingsResponse AI::getSettings() const
 {
@@ -242,170 +556,368 @@ SettingsResponse AI::getSettings() const
                             temperature, topP, systemPrompt);
 }
 
-std::string AI::generateResponse(AIStreamCallback streamCallback)
+void AI::setFallbackEndpoints(const std::vector<AIEndpoint> &endpoints)
+{
+    for (const auto &endpoint : endpoints)
+        ASSERT(!endpoint.baseUrl.empty());
+    conversationManager.saveEndpoints(endpoints);
+    std::lock_guard<std::mutex> settingsLock(settingsMutex);
+    fallbackEndpoints = endpoints;
+}
+std::vector<AIEndpoint> AI::getFallbackEndpoints() const
+{
+    std::lock_guard<std::mutex> settingsLock(settingsMutex);
+    return fallbackEndpoints;
+}
+std::vector<EndpointHealth> AI::getEndpointHealth() const
+{
+    return router.health(endpoints());
+}
+
+std::vector<AIEndpoint> AI::endpoints() const
+{
+    std::lock_guard<std::mutex> settingsLock(settingsMutex);
+    std::vector<AIEndpoint> result{AIEndpoint{baseUrl, apiKey}};
+    for (const auto &endpoint : fallbackEndpoints)
+        if (endpoint.baseUrl != baseUrl)
+            result.push_back(endpoint);
+    return result;
+}
+
+// Probes go through FetchEngine and so through the shared curl pool; besides measuring
+// an endpoint they leave a warm connection to it behind
+void AI::probeEndpoints(const std::vector<AIEndpoint> &candidates)
 {
+    if (candidates.size() < 2)
+        return;
+    // A probe result is worthless once the AI is gone, so it does not keep it alive
+    std::weak_ptr<AI> weakSelf = weak_from_this();
+    for (const auto &endpoint : router.dueForProbe(candidates))
+    {
+        std::string probedUrl = endpoint.baseUrl;
+        FetchEngine::submit(probedUrl + "models",
+                            FetchOptions("GET", {{"Authorization", "Bearer " + endpoint.apiKey}}),
+                            [weakSelf, probedUrl](Response &response, std::exception_ptr error)
+                            {
+                                std::shared_ptr<AI> self = weakSelf.lock();
+                                if (!self)
+                                    return;
+                                if (error || EndpointRouter::retryable(response.status))
+                                    self->router.failed(probedUrl);
+                                else
+                                    self->router.succeeded(probedUrl, response.timing.startTransferMs); });
+    }
+}
+
+Response AI::fetchWithFailover(const std::string &path, FetchOptions options)
+{
+    std::vector<AIEndpoint> candidates = endpoints();
+    probeEndpoints(candidates);
+    candidates = router.rank(candidates);
+
+    std::exception_ptr lastError;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        const AIEndpoint &endpoint = candidates[i];
+        options.headers["Authorization"] = "Bearer " + endpoint.apiKey;
+        try
+        {
+            Response response = Fetch::fetch(endpoint.baseUrl + path, options);
+            // A fresh cache hit says nothing about the endpoint; the server was never contacted.
+            // A 304 revalidation is also marked cached but did reach it, and carries its timing.
+            if (response.cached && response.timing.totalMs == 0)
+                return response;
+            bool retryable = EndpointRouter::retryable(response.status);
+            if (retryable)
+                router.failed(endpoint.baseUrl);
+            else
+                router.succeeded(endpoint.baseUrl, response.timing.startTransferMs);
+            if (!retryable || i + 1 == candidates.size())
+                return response;
+        }
+        catch (const std::exception &)
+        {
+            router.failed(endpoint.baseUrl);
+            lastError = std::current_exception();
+        }
+    }
+    std::rethrow_exception(lastError);
+}
+
+// Per-request state, owned by the callbacks FetchEngine runs on its I/O thread
+struct AI::Generation
+{
+    AIStreamCallback streamCallback;
+    AICompletionCallback completion;
+    std::chrono::milliseconds checkpointInterval;
+    size_t checkpointThreshold;
+    std::shared_ptr<std::atomic<bool>> cancellationToken;
+
+    std::string requestBody;
+    // Ranked when the generation starts; attempt indexes the one in use
+    std::vector<AIEndpoint> endpoints;
+    size_t attempt = 0;
+    bool streamStarted = false;
+
+    std::string fullAssistantResponse;
+    bool wasCancelled = false;
+    bool responseStarted = false;
+    std::string assistantNodeId;
+    ConversationNode::STOP_REASON finalStopReason = ConversationNode::STOP_REASON_NONE;
+    size_t uncheckpointedBytes = 0;
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+    ChatChunkExtractor extractor;
+    ChatChunk chunk;
+    std::string content;
+};
+
+void AI::generateResponse(AIStreamCallback streamCallback, AICompletionCallback completion)
+{
+    auto generation = std::make_shared<Generation>();
+    generation->streamCallback = std::move(streamCallback);
+    generation->completion = std::move(completion);
+
     nlohmann::json requestJson;
+    ContextPolicy policy;
+    TokenEstimator estimator = TokenEstimator::forModel("");
     {
         std::lock_guard<std::mutex> settingsLock(settingsMutex);
         requestJson["model"] = model;
         requestJson["max_tokens"] = maxTokens;
         requestJson["temperature"] = temperature;
         requestJson["top_p"] = topP;
+        generation->checkpointInterval = std::chrono::milliseconds(checkpointIntervalMs);
+        generation->checkpointThreshold = checkpointBytes;
+        policy = contextPolicy;
+        estimator = TokenEstimator::forModel(model);
     }
 
     requestJson["stream"] = true;
 
     const std::string_view roleString[3] = {"user", "assistant", "system"};
     nlohmann::json messagesArray = nlohmann::json::array();
+    ContextReport contextReport;
 
     {
         std::shared_lock<std::shared_mutex> stateLock(stateMutex);
-        for (const auto &msg : getPathFromRoot(currentNodeId))
-            messagesArray.push_back({{"role", roleString[msg.role]},
-                                     {"content", msg.content}});
+        for (const ConversationNode *msg : policy.select(currentPath, estimator, contextReport))
+            messagesArray.push_back({{"role", roleString[msg->role]},
+                                     {"content", msg->content}});
     }
 
     requestJson["messages"] = messagesArray;
+    std::string requestBody = requestJson.dump();
+    contextReport.requestBytes = requestBody.size();
 
-    std::string fullAssistantResponse;
-    std::mutex responseMutex;
-    bool wasCancelled = false;
-    bool responseStarted = false;
-    std::string assistantNodeId;
-    ConversationNode::STOP_REASON finalStopReason = ConversationNode::STOP_REASON_NONE;
-
-    std::shared_ptr<std::atomic<bool>> cancellationToken;
     {
         std::lock_guard<std::mutex> cancelLock(requestCancelMutex);
+        if (currentRequestCancelled)
+            throw std::runtime_error("A response is already being generated");
         currentRequestCancelled = std::make_shared<std::atomic<bool>>(false);
-        cancellationToken = currentRequestCancelled;
+        generation->cancellationToken = currentRequestCancelled;
+        lastContextReport = contextReport;
     }
 
-    StreamCallback packedStreamCallback = [&fullAssistantResponse, &responseMutex, &wasCancelled, &responseStarted, &assistantNodeId, &finalStopReason, cancellationToken, streamCallback, this](const std::string &chunk)
-    {
-        if (cancellationToken->load())
-        {
-            wasCancelled = true;
-            finalStopReason = ConversationNode::STOP_REASON_USER_STOPPED;
-            return;
-        }
+    std::vector<AIEndpoint> candidates = endpoints();
+    probeEndpoints(candidates);
+    generation->endpoints = router.rank(candidates);
+    generation->requestBody = std::move(requestBody);
+    submitGeneration(generation);
+}
 
-        if (chunk.empty() || chunk == "[DONE]")
-            return;
+void AI::submitGeneration(const std::shared_ptr<Generation> &generation)
+{
+    std::shared_ptr<AI> self = shared_from_this();
+    const AIEndpoint &endpoint = generation->endpoints[generation->attempt];
+    FetchEngine::submit(endpoint.baseUrl + "chat/completions",
+                        FetchOptions("POST",
+                                     {{"Content-Type", "application/json"},
+                                      {"Authorization", "Bearer " + endpoint.apiKey},
+                                      {"Accept", "text/event-stream"}},
+                                     generation->requestBody,
+                                     true,
+                                     [generation, self](const SseEvent &event)
+                                     { self->onStreamEvent(*generation, event); },
+                                     0,
+                                     generation->cancellationToken),
+                        [generation, self](Response &response, std::exception_ptr error)
+                        {
+                            if (!self->retryGeneration(generation, response, error))
+                                self->onGenerationDone(*generation, response, error); });
+}
 
-        nlohmann::json chunkJson = nlohmann::json::parse(chunk);
-        auto choice = chunkJson["choices"][0];
+// Records the outcome with the router. A failed request is sent to the next endpoint
+// only while nothing has been streamed, so the user never sees a reply restart.
+bool AI::retryGeneration(const std::shared_ptr<Generation> &generation, const Response &response, std::exception_ptr error)
+{
+    if (generation->wasCancelled || generation->cancellationToken->load())
+        return false;
+    const AIEndpoint &endpoint = generation->endpoints[generation->attempt];
+    if (!error && !EndpointRouter::retryable(response.status))
+    {
+        router.succeeded(endpoint.baseUrl, response.timing.startTransferMs);
+        return false;
+    }
+    router.failed(endpoint.baseUrl);
+    if (generation->streamStarted || generation->attempt + 1 >= generation->endpoints.size())
+        return false;
+    generation->attempt++;
+    submitGeneration(generation);
+    return true;
+}
 
-        if (choice["finish_reason"].is_string())
-        {
-            std::string finishReason = choice["finish_reason"];
-            if (finishReason == "stop")
-                finalStopReason = ConversationNode::STOP_REASON_STOP;
-            else if (finishReason == "length")
-                finalStopReason = ConversationNode::STOP_REASON_LENGTH;
-            else if (finishReason == "content_filter")
-                finalStopReason = ConversationNode::STOP_REASON_CONTENT_FILTER;
-            else
-                finalStopReason = ConversationNode::STOP_REASON_ERROR;
-        }
+// Deltas only update the in-memory node; the row is rewritten when enough time or text has accumulated
+void AI::checkpoint(Generation &generation, bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!force && generation.uncheckpointedBytes < generation.checkpointThreshold &&
+        now - generation.lastCheckpoint < generation.checkpointInterval)
+        return;
+    generation.uncheckpointedBytes = 0;
+    generation.lastCheckpoint = now;
+    saveConversation();
+}
 
-        std::string content = "";
-        if (choice["delta"]["reasoning_content"].is_string())
-            content += choice["delta"]["reasoning_content"];
-        if (choice["delta"]["content"].is_string())
-            content += choice["delta"]["content"];
-        if (content != "")
+void AI::finishAssistantNode(Generation &generation, ConversationNode::STOP_REASON stopReason)
+{
+    if (!generation.responseStarted || generation.assistantNodeId.empty())
+        return;
+    {
+        std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+        ConversationNode *assistantNode = findNode(generation.assistantNodeId);
+        if (assistantNode)
         {
-            {
-                std::lock_guard<std::mutex> lock(responseMutex);
-                fullAssistantResponse += content;
-
-                if (!responseStarted && !content.empty())
-                {
-                    responseStarted = true;
-                    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
-                    assistantNodeId = strUtils::randomId();
-                    ConversationNode *parent = findNode(currentNodeId);
-                    if (parent)
-                        parent->childIds.push_back(assistantNodeId);
-                    nodeMap[assistantNodeId] = std::make_unique<ConversationNode>(assistantNodeId, ConversationNode::ROLE_ASSISTANT, fullAssistantResponse, currentNodeId);
-                    currentNodeId = assistantNodeId;
-                    stateLock.unlock();
-                    saveConversation();
-                }
-                else if (responseStarted && !assistantNodeId.empty())
-                {
-                    std::unique_lock<std::shared_mutex> stateLock(stateMutex);
-                    ConversationNode *assistantNode = findNode(assistantNodeId);
-                    if (assistantNode)
-                        assistantNode->content = fullAssistantResponse;
-                    stateLock.unlock();
-                    saveConversation();
-                }
-            }
-            streamCallback(content);
+            assistantNode->stopReason = stopReason;
+            markDirty(generation.assistantNodeId);
         }
-    };
+    }
+    checkpoint(generation, true);
+}
 
-    std::string currentApiKey, currentBaseUrl;
+void AI::onStreamEvent(Generation &generation, const SseEvent &event)
+{
+    if (generation.cancellationToken->load())
     {
-        std::lock_guard<std::mutex> settingsLock(settingsMutex);
-        currentApiKey = apiKey;
-        currentBaseUrl = baseUrl;
+        generation.wasCancelled = true;
+        generation.finalStopReason = ConversationNode::STOP_REASON_USER_STOPPED;
+        return;
     }
 
-    Response response = Fetch::fetch(currentBaseUrl + "chat/completions",
-                                     FetchOptions("POST",
-                                                  {{"Content-Type", "application/json"},
-                                                   {"Authorization", "Bearer " + currentApiKey},
-                                                   {"Accept", "text/event-stream"}},
-                                                  requestJson.dump(),
-                                                  true,
-                                                  packedStreamCallback,
-                                                  0,
-                                                  cancellationToken));
+    generation.streamStarted = true;
+    if (event.data.empty() || event.data == "[DONE]")
+        return;
+
+    ChatChunk &chunk = generation.chunk;
+    generation.extractor.extract(event.data, chunk);
+
+    if (chunk.finished)
     {
-        std::lock_guard<std::mutex> cancelLock(requestCancelMutex);
-        currentRequestCancelled = nullptr;
+        if (chunk.finishReason == "stop")
+            generation.finalStopReason = ConversationNode::STOP_REASON_STOP;
+        else if (chunk.finishReason == "length")
+            generation.finalStopReason = ConversationNode::STOP_REASON_LENGTH;
+        else if (chunk.finishReason == "content_filter")
+            generation.finalStopReason = ConversationNode::STOP_REASON_CONTENT_FILTER;
+        else
+            generation.finalStopReason = ConversationNode::STOP_REASON_ERROR;
+    }
+
+    std::string &content = generation.content;
+    content.assign(chunk.reasoningContent).append(chunk.content);
+    if (content.empty())
+        return;
+
+    generation.fullAssistantResponse += content;
+    if (!generation.responseStarted)
+    {
+        generation.responseStarted = true;
+        std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+        generation.assistantNodeId = strUtils::randomId();
+        ConversationNode *parent = findNode(currentNodeId);
+        if (parent)
+            parent->childIds.push_back(generation.assistantNodeId);
+        touch(parent);
+        nodeMap[generation.assistantNodeId] = std::make_unique<ConversationNode>(generation.assistantNodeId, ConversationNode::ROLE_ASSISTANT, generation.fullAssistantResponse, currentNodeId);
+        markNew(generation.assistantNodeId);
+        currentNodeId = generation.assistantNodeId;
+        rebuildPath();
+        stateLock.unlock();
+        checkpoint(generation, true);
     }
-    if (wasCancelled || cancellationToken->load())
+    else if (!generation.assistantNodeId.empty())
     {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        if (responseStarted && !assistantNodeId.empty())
+        std::unique_lock<std::shared_mutex> stateLock(stateMutex);
+        ConversationNode *assistantNode = findNode(generation.assistantNodeId);
+        if (assistantNode)
         {
-            std::unique_lock<std::shared_mutex> stateLock(stateMutex);
-            ConversationNode *assistantNode = findNode(assistantNodeId);
-            if (assistantNode)
-            {
-                assistantNode->stopReason = ConversationNode::STOP_REASON_USER_STOPPED;
-            }
-            stateLock.unlock();
-            saveConversation();
+            assistantNode->content = generation.fullAssistantResponse;
+            markDirty(generation.assistantNodeId);
         }
-        return fullAssistantResponse;
+        stateLock.unlock();
+        generation.uncheckpointedBytes += content.size();
+        checkpoint(generation, false);
     }
-    if (!response.isOk())
-        THROW_NETWORK_ERROR(response.status);
+    generation.streamCallback(content);
+}
 
+void AI::onGenerationDone(Generation &generation, Response &response, std::exception_ptr error)
+{
     {
-        std::lock_guard<std::mutex> lock(responseMutex);
-        if (!responseStarted && !fullAssistantResponse.empty())
-        {
-            addNode(ConversationNode::ROLE_ASSISTANT, fullAssistantResponse);
-        }
-        else if (responseStarted && !assistantNodeId.empty() && finalStopReason != ConversationNode::STOP_REASON_NONE)
-        {
-            std::unique_lock<std::shared_mutex> stateLock(stateMutex);
-            ConversationNode *assistantNode = findNode(assistantNodeId);
-            if (assistantNode)
-            {
-                assistantNode->stopReason = finalStopReason;
-            }
-            stateLock.unlock();
-            saveConversation();
-        }
-        return fullAssistantResponse;
+        std::lock_guard<std::mutex> cancelLock(requestCancelMutex);
+        currentRequestCancelled = nullptr;
+        lastStreamStats = generation.extractor.getStats();
+    }
+
+    if (generation.wasCancelled || generation.cancellationToken->load())
+    {
+        finishAssistantNode(generation, ConversationNode::STOP_REASON_USER_STOPPED);
+        generation.completion(generation.fullAssistantResponse, nullptr);
+        return;
+    }
+    try
+    {
+        if (error)
+            std::rethrow_exception(error);
+        if (!response.isOk())
+            THROW_NETWORK_ERROR(response.status);
+    }
+    catch (...)
+    {
+        finishAssistantNode(generation, ConversationNode::STOP_REASON_ERROR);
+        generation.completion("", std::current_exception());
+        return;
     }
+    finishAssistantNode(generation, generation.finalStopReason != ConversationNode::STOP_REASON_NONE ? generation.finalStopReason : ConversationNode::STOP_REASON_DONE);
+    generation.completion(generation.fullAssistantResponse, nullptr);
+}
+
+void AI::setStreamCheckpoint(int intervalMs, size_t bytes)
+{
+    ASSERT(intervalMs >= 0);
+    std::lock_guard<std::mutex> settingsLock(settingsMutex);
+    checkpointIntervalMs = intervalMs;
+    checkpointBytes = bytes;
+}
+
+ChatChunkStats AI::getStreamStats()
+{
+    std::lock_guard<std::mutex> cancelLock(requestCancelMutex);
+    return lastStreamStats;
+}
+
+void AI::setContextPolicy(int64_t maxPromptTokens, int keepTurns)
+{
+    ASSERT(maxPromptTokens >= 0);
+    ASSERT(keepTurns >= 0);
+    std::lock_guard<std::mutex> settingsLock(settingsMutex);
+    contextPolicy.maxPromptTokens = maxPromptTokens;
+    contextPolicy.keepTurns = keepTurns;
+}
+
+ContextReport AI::getContextReport()
+{
+    std::lock_guard<std::mutex> cancelLock(requestCancelMutex);
+    return lastContextReport;
 }
 
 void AI::stopGeneration()
@@ -417,17 +929,11 @@ void AI::stopGeneration()
 
 std::vector<std::string> AI::getModels()
 {
-    std::string currentApiKey, currentBaseUrl;
-    {
-        std::lock_guard<std::mutex> settingsLock(settingsMutex);
-        currentApiKey = apiKey;
-        currentBaseUrl = baseUrl;
-    }
-
     std::vector<std::string> modelIds;
-    Response response = Fetch::fetch(currentBaseUrl + "models",
-                                     FetchOptions("GET",
-                                                  {{"Authorization", "Bearer " + currentApiKey}}));
+    FetchOptions options("GET");
+    // The model list rarely changes; the settings page asks for it every time it opens
+    options.cacheTtl = 3600;
+    Response response = fetchWithFailover("models", options);
     if (!response.isOk())
         THROW_NETWORK_ERROR(response.status);
     nlohmann::json responseJson = response.json();
@@ -438,16 +944,9 @@ std::vector<std::string> AI::getModels()
 
 float AI::getUserBalance()
 {
-    std::string currentApiKey, currentBaseUrl;
-    {
-        std::lock_guard<std::mutex> settingsLock(settingsMutex);
-        currentApiKey = apiKey;
-        currentBaseUrl = baseUrl;
-    }
-
-    Response response = Fetch::fetch(currentBaseUrl + "user/balance",
-                                     FetchOptions("GET",
-                                                  {{"Authorization", "Bearer " + currentApiKey}}));
+    FetchOptions options("GET");
+    options.cacheTtl = 30;
+    Response response = fetchWithFailover("user/balance", options);
     if (!response.isOk())
         THROW_NETWORK_ERROR(response.status);
     nlohmann::json responseJson = response.json();
@@ -22,57 +22,133 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <shared_mutex>
 #include <nlohmann/json.hpp>
 #include "Fetch.hpp"
 #include "ConversationInfo.hpp"
 #include "AICallback.hpp"
-#include "ConversationInfo.hpp"
+#include "ChatChunkExtractor.hpp"
 #include "ConversationManager.hpp"
+#include "PathChanges.hpp"
+#include "BranchInfo.hpp"
+#include "ContentCache.hpp"
+#include "ContextPolicy.hpp"
 #include "SettingsResponse.hpp"
+#include "EndpointRouter.hpp"
 
-class AI
+// Owned through a shared_ptr: FetchEngine callbacks hold a reference until the request completes
+class AI : public std::enable_shared_from_this<AI>
 {
 private:
     ConversationManager conversationManager;
     std::string apiKey, baseUrl;
+    // Tried after baseUrl, in the order the router ranks them
+    std::vector<AIEndpoint> fallbackEndpoints;
+    EndpointRouter router;
     std::string model = "deepseek-chat";
     int maxTokens = 1000;
     double temperature = 0.7;
     double topP = 1.0;
     std::string systemPrompt = "你是一个有用的助手。请尽力回答问题。请不要使用任何 Markdown 语法或者表情符号等特殊字符来格式化回答。";
 
+    // A streamed reply is written to the database once this much time has passed or text has
+    // arrived since the last write, and always when the stream ends. After a crash the stored
+    // reply is a prefix of what was received and keeps STOP_REASON_NONE; loadConversation
+    // reports such replies as STOP_REASON_ERROR.
+    int checkpointIntervalMs = 1000;
+    size_t checkpointBytes = 2048;
+
+    // Trims the history sent with each request; unlimited by default
+    ContextPolicy contextPolicy;
+
     std::unordered_map<std::string, std::unique_ptr<ConversationNode>> nodeMap;
     std::string currentNodeId, rootNodeId;
     std::string conversationId;
 
+    // Root-to-current path, rebuilt whenever the current node or the tree changes; guarded by stateMutex
+    std::vector<ConversationNode *> currentPath;
+    uint64_t revision = 0, pathRevision = 0, conversationRevision = 0;
+
+    // Conversations are loaded as a skeleton; node content is read on demand and
+    // unloaded again, least recently used first, once it exceeds this budget
+    ContentCache contentCache{256 * 1024};
+
+    // Nodes changed since the last save; guarded by stateMutex
+    std::unordered_set<std::string> newNodeIds, dirtyNodeIds, deletedNodeIds;
+    // Changes of saves the database rolled back, merged into the sets above by
+    // the next save; filled on the database thread, so guarded by failedSaveMutex
+    struct FailedSave
+    {
+        std::string conversationId;
+        std::vector<std::string> newNodeIds, dirtyNodeIds, deletedNodeIds;
+    };
+    std::vector<FailedSave> failedSaves;
+    std::mutex failedSaveMutex;
     mutable std::shared_mutex stateMutex;
     mutable std::mutex settingsMutex;
     mutable std::mutex conversationMutex;
 
+    // All guarded by requestCancelMutex
     std::shared_ptr<std::atomic<bool>> currentRequestCancelled;
+    ChatChunkStats lastStreamStats;
+    ContextReport lastContextReport;
     std::mutex requestCancelMutex;
 
     ConversationNode *findNode(const std::string &nodeId);
-    std::vector<ConversationNode> getPathFromRoot(const std::string &nodeId);
+    void touch(ConversationNode *node);
+    void rebuildPath();
+    void onConversationChanged();
+    ConversationNode *descend(ConversationNode *node, bool lastChild);
+    void loadContent(const std::vector<ConversationNode *> &nodes);
+    void evictContent();
 
-    void saveConversation();
+    void markNew(const std::string &nodeId);
+    void markDirty(const std::string &nodeId);
+    void markDeleted(const std::string &nodeId);
+    void clearChanges();
+
+    std::vector<AIEndpoint> endpoints() const;
+    void probeEndpoints(const std::vector<AIEndpoint> &candidates);
+    // Only for idempotent requests: moves on to the next endpoint on network errors and retryable statuses
+    Response fetchWithFailover(const std::string &path, FetchOptions options);
+
+    struct Generation;
+    void submitGeneration(const std::shared_ptr<Generation> &generation);
+    bool retryGeneration(const std::shared_ptr<Generation> &generation, const Response &response, std::exception_ptr error);
+    void checkpoint(Generation &generation, bool force);
+    void finishAssistantNode(Generation &generation, ConversationNode::STOP_REASON stopReason);
+    void onStreamEvent(Generation &generation, const SseEvent &event);
+    void onGenerationDone(Generation &generation, Response &response, std::exception_ptr error);
 
 public:
     AI();
 
+    // Writes pending node changes in the background. The constructor leaves its default
+    // conversation unsaved: call this once the AI is owned by a shared_ptr, which a
+    // failed save needs to be queued for retry
+    void saveConversation();
+
     void addNode(ConversationNode::ROLE role, std::string content);
     bool deleteNode(const std::string &nodeId);
     bool switchNode(const std::string &nodeId);
+    bool switchToLeaf(const std::string &nodeId, bool lastChild);
+    bool switchSibling(const std::string &nodeId, int offset);
+    bool setPinned(const std::string &nodeId, bool pinned);
+    std::vector<BranchStep> getBranch();
+    std::vector<SubtreeEntry> getSubtree(const std::string &nodeId, int maxDepth);
 
     std::vector<std::string> getChildren(const std::string &nodeId);
     std::vector<ConversationNode> getCurrentPath();
+    PathChanges getPathChanges(uint64_t sinceVersion);
     std::string getCurrentNodeId() const;
     std::string getRootNodeId() const;
     std::string getConversationId() const;
 
     std::vector<ConversationInfo> getConversationList();
+    std::vector<ConversationInfo> getConversationPage(size_t limit, const ConversationInfo *after);
+    SearchPage searchMessages(const std::string &query, size_t limit, const SearchCursor *after = nullptr);
     void createConversation(const std::string &title);
     void loadConversation(const std::string &conversationId);
     void deleteConversation(const std::string &conversationId);
@@ -82,9 +158,17 @@ public:
                      const std::string &model, int maxTokens,
                      double temperature, double topP, std::string systemPrompt);
     SettingsResponse getSettings() const;
+    void setFallbackEndpoints(const std::vector<AIEndpoint> &endpoints);
+    std::vector<AIEndpoint> getFallbackEndpoints() const;
+    std::vector<EndpointHealth> getEndpointHealth() const;
 
-    std::string generateResponse(AIStreamCallback streamCallback);
+    // Returns once the request is queued; both callbacks run on the FetchEngine I/O thread
+    void generateResponse(AIStreamCallback streamCallback, AICompletionCallback completion);
     void stopGeneration();
+    void setStreamCheckpoint(int intervalMs, size_t bytes);
+    ChatChunkStats getStreamStats();
+    void setContextPolicy(int64_t maxPromptTokens, int keepTurns);
+    ContextReport getContextReport();
     std::vector<std::string> getModels();
     float getUserBalance();
 };
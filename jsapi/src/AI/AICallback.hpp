@@ -19,5 +19,8 @@
 
 #include <string>
 #include <functional>
+#include <exception>
 
 using AIStreamCallback = std::function<void(const std::string &messageDelta)>;
+// error is null on success; response then holds the whole reply, or the part received before a stop
+using AICompletionCallback = std::function<void(const std::string &response, std::exception_ptr error)>;
@@ -0,0 +1,164 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ChatChunkExtractor.hpp"
+#include <chrono>
+#include <stdexcept>
+
+void ChatChunk::clear()
+{
+    content.clear();
+    reasoningContent.clear();
+    finishReason.clear();
+    finished = false;
+}
+
+// The path of interest is {choices: [ {delta: {content, reasoning_content}, finish_reason} ]},
+// i.e. frames[0] is the root object, frames[1] the choices array, frames[2] the first choice
+// and frames[3] its delta.
+ChatChunkExtractor::FIELD ChatChunkExtractor::fieldAt(size_t depth) const
+{
+    return depth < frames.size() && !frames[depth].array ? frames[depth].key : FIELD_OTHER;
+}
+bool ChatChunkExtractor::inFirstChoice() const
+{
+    return frames.size() >= 3 && fieldAt(0) == FIELD_CHOICES &&
+           frames[1].array && frames[1].index == 0;
+}
+std::string *ChatChunkExtractor::target()
+{
+    if (!inFirstChoice())
+        return nullptr;
+    if (frames.size() == 3 && fieldAt(2) == FIELD_FINISH_REASON)
+        return &output->finishReason;
+    if (frames.size() == 4 && fieldAt(2) == FIELD_DELTA)
+    {
+        if (fieldAt(3) == FIELD_CONTENT)
+            return &output->content;
+        if (fieldAt(3) == FIELD_REASONING_CONTENT)
+            return &output->reasoningContent;
+    }
+    return nullptr;
+}
+void ChatChunkExtractor::beginValue()
+{
+    if (!frames.empty() && frames.back().array)
+        frames.back().index++;
+}
+
+void ChatChunkExtractor::extract(std::string_view data, ChatChunk &chunk)
+{
+    auto start = std::chrono::steady_clock::now();
+    chunk.clear();
+    frames.clear();
+    output = &chunk;
+    bool ok = json::sax_parse(data.begin(), data.end(), this);
+    output = nullptr;
+    if (!ok)
+        throw std::runtime_error("Failed to parse stream chunk: " + std::string(data));
+    stats.chunks++;
+    stats.bytes += data.size();
+    stats.parseNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+}
+const ChatChunkStats &ChatChunkExtractor::getStats() const { return stats; }
+
+bool ChatChunkExtractor::null()
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::boolean(bool)
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::number_integer(json::number_integer_t)
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::number_unsigned(json::number_unsigned_t)
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::number_float(json::number_float_t, const json::string_t &)
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::string(json::string_t &val)
+{
+    beginValue();
+    if (std::string *field = target())
+    {
+        field->append(val);
+        if (field == &output->finishReason)
+            output->finished = true;
+    }
+    return true;
+}
+bool ChatChunkExtractor::binary(json::binary_t &)
+{
+    beginValue();
+    return true;
+}
+bool ChatChunkExtractor::start_object(std::size_t)
+{
+    beginValue();
+    frames.push_back({false, -1, FIELD_OTHER});
+    return true;
+}
+bool ChatChunkExtractor::key(json::string_t &val)
+{
+    FIELD field = FIELD_OTHER;
+    size_t depth = frames.size() - 1;
+    if (depth == 0 && val == "choices")
+        field = FIELD_CHOICES;
+    else if (depth == 2 && val == "delta")
+        field = FIELD_DELTA;
+    else if (depth == 2 && val == "finish_reason")
+        field = FIELD_FINISH_REASON;
+    else if (depth == 3 && val == "content")
+        field = FIELD_CONTENT;
+    else if (depth == 3 && val == "reasoning_content")
+        field = FIELD_REASONING_CONTENT;
+    frames.back().key = field;
+    return true;
+}
+bool ChatChunkExtractor::end_object()
+{
+    frames.pop_back();
+    return true;
+}
+bool ChatChunkExtractor::start_array(std::size_t)
+{
+    beginValue();
+    frames.push_back({true, -1, FIELD_OTHER});
+    return true;
+}
+bool ChatChunkExtractor::end_array()
+{
+    frames.pop_back();
+    return true;
+}
+bool ChatChunkExtractor::parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &)
+{
+    return false;
+}
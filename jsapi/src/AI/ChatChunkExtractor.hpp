@@ -0,0 +1,94 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+struct ChatChunk
+{
+    std::string content, reasoningContent, finishReason;
+    bool finished = false;
+
+    void clear();
+};
+
+struct ChatChunkStats
+{
+    int64_t chunks = 0;
+    int64_t bytes = 0;
+    int64_t parseNanoseconds = 0;
+};
+
+// Pulls choices[0].delta.content, choices[0].delta.reasoning_content and
+// choices[0].finish_reason out of a streamed chat-completion chunk with a SAX
+// pass, without building a json tree. The output buffers are reused between
+// chunks, so a steady stream stops allocating once they have grown.
+class ChatChunkExtractor
+{
+private:
+    enum FIELD
+    {
+        FIELD_OTHER,
+        FIELD_CHOICES,
+        FIELD_DELTA,
+        FIELD_FINISH_REASON,
+        FIELD_CONTENT,
+        FIELD_REASONING_CONTENT,
+    };
+
+    struct Frame
+    {
+        bool array;
+        int index;
+        FIELD key;
+    };
+
+    std::vector<Frame> frames;
+    ChatChunk *output = nullptr;
+    ChatChunkStats stats;
+
+    FIELD fieldAt(size_t depth) const;
+    bool inFirstChoice() const;
+    std::string *target();
+    void beginValue();
+
+public:
+    using json = nlohmann::json;
+
+    // Throws std::runtime_error on malformed JSON
+    void extract(std::string_view data, ChatChunk &chunk);
+    const ChatChunkStats &getStats() const;
+
+    bool null();
+    bool boolean(bool val);
+    bool number_integer(json::number_integer_t val);
+    bool number_unsigned(json::number_unsigned_t val);
+    bool number_float(json::number_float_t val, const json::string_t &s);
+    bool string(json::string_t &val);
+    bool binary(json::binary_t &val);
+    bool start_object(std::size_t elements);
+    bool key(json::string_t &val);
+    bool end_object();
+    bool start_array(std::size_t elements);
+    bool end_array();
+    bool parse_error(std::size_t position, const std::string &last_token, const nlohmann::detail::exception &ex);
+};
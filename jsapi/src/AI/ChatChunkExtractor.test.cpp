@@ -0,0 +1,152 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+// Replays recorded chat-completion streams through SseDecoder and checks that
+// ChatChunkExtractor reads every event the way the json tree it replaced did.
+// Each stream is also fed split at every offset, so strings cut between
+// network reads have to come out the same.
+
+#include "ChatChunkExtractor.hpp"
+#include "../SseDecoder.hpp"
+#include <iostream>
+#include <vector>
+
+// The field access AI::generateResponse used before the SAX pass
+static ChatChunk domChunk(const std::string &data)
+{
+    ChatChunk chunk;
+    nlohmann::json chunkJson = nlohmann::json::parse(data);
+    auto choice = chunkJson["choices"][0];
+    if (choice["finish_reason"].is_string())
+    {
+        chunk.finishReason = choice["finish_reason"];
+        chunk.finished = true;
+    }
+    if (choice["delta"]["reasoning_content"].is_string())
+        chunk.reasoningContent = choice["delta"]["reasoning_content"];
+    if (choice["delta"]["content"].is_string())
+        chunk.content = choice["delta"]["content"];
+    return chunk;
+}
+
+static std::string describe(const ChatChunk &chunk)
+{
+    return "reasoning=" + chunk.reasoningContent + " content=" + chunk.content +
+           " finished=" + (chunk.finished ? "yes" : "no") + " finish_reason=" + chunk.finishReason;
+}
+
+// Returns the number of events whose fields differ between the two paths
+static int replay(const std::string &stream, size_t cut, std::string &transcript)
+{
+    int failures = 0;
+    ChatChunkExtractor extractor;
+    ChatChunk chunk;
+    SseDecoder decoder([&](const SseEvent &event)
+                       {
+                           if (event.data == "[DONE]")
+                               return;
+                           ChatChunk expected = domChunk(event.data);
+                           extractor.extract(event.data, chunk);
+                           if (describe(chunk) != describe(expected))
+                           {
+                               std::cerr << "Fields differ for " << event.data << "\n  sax: " << describe(chunk)
+                                         << "\n  dom: " << describe(expected) << std::endl;
+                               failures++;
+                           }
+                           transcript += chunk.reasoningContent + chunk.content; });
+    decoder.feed(std::string_view(stream).substr(0, cut));
+    decoder.feed(std::string_view(stream).substr(cut));
+    decoder.finish();
+    return failures;
+}
+
+int main()
+{
+    // Each stream with the reasoning and content text it adds up to
+    const std::vector<std::pair<std::string, std::string>> streams = {
+        // A reasoning model: role chunk, reasoning deltas with content null, then content, finish_reason and a usage chunk without choices
+        {R"(data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"role":"assistant","content":null,"reasoning_content":""},"logprobs":null,"finish_reason":null}]}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"content":null,"reasoning_content":"Think \"carefully\"\n"},"logprobs":null,"finish_reason":null}]}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"content":null,"reasoning_content":"\u4f60好\ud83d\ude00\t\\"},"logprobs":null,"finish_reason":null}]}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"content":"Hel","reasoning_content":null},"logprobs":null,"finish_reason":null}]}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"content":"lo, 世界\/\r\n","reasoning_content":null},"logprobs":null,"finish_reason":null}]}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[{"index":0,"delta":{"content":"","reasoning_content":null},"logprobs":null,"finish_reason":"stop"}],"usage":{"prompt_tokens":12,"completion_tokens":9,"total_tokens":21}}
+
+data: {"id":"a1","object":"chat.completion.chunk","created":1760000000,"model":"deepseek-reasoner","choices":[],"usage":{"prompt_tokens":12,"completion_tokens":9,"total_tokens":21}}
+
+data: [DONE]
+
+)",
+         "Think \"carefully\"\n你好\xF0\x9F\x98\x80\t\\Hello, 世界/\r\n"},
+        // Keys in another order, a second choice, look-alike keys at other depths and a length stop
+        {R"(data: {"choices":[{"finish_reason":null,"delta":{"tool_calls":[{"function":{"content":"no"}}],"content":"A"},"index":0},{"index":1,"delta":{"content":"second"},"finish_reason":"stop"}],"content":"root"}
+
+data: {"content":"root","choices":[{"index":0,"delta":{"content":"B","extra":{"content":"nested","reasoning_content":"nested"}},"finish_reason":"length"}]}
+
+)",
+         "AB"},
+        // Content filtered mid-answer, with no delta at all in the last chunk
+        {R"(data: {"choices":[{"index":0,"delta":{"content":"\"quoted\" A"}}]}
+
+data: {"choices":[{"index":0,"finish_reason":"content_filter"}]}
+
+)",
+         "\"quoted\" A"},
+    };
+
+    int failures = 0;
+    for (const auto &[stream, expected] : streams)
+        for (size_t cut = 0; cut <= stream.size(); cut++)
+        {
+            std::string transcript;
+            failures += replay(stream, cut, transcript);
+            if (transcript != expected)
+            {
+                std::cerr << "Split at " << cut << " produced \"" << transcript << "\" instead of \"" << expected << "\"" << std::endl;
+                failures++;
+            }
+        }
+
+    // Both paths refuse a chunk that is not JSON
+    const std::string truncated = "{\"choices\":[{\"delta\":{\"content\":\"cut";
+    ChatChunkExtractor extractor;
+    ChatChunk chunk;
+    try
+    {
+        extractor.extract(truncated, chunk);
+        std::cerr << "Truncated chunk was accepted by the extractor" << std::endl;
+        failures++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    try
+    {
+        domChunk(truncated);
+        std::cerr << "Truncated chunk was accepted by the json tree" << std::endl;
+        failures++;
+    }
+    catch (const nlohmann::json::exception &)
+    {
+    }
+    return failures == 0 ? 0 : 1;
+}
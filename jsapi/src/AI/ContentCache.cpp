@@ -0,0 +1,69 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ContentCache.hpp"
+
+ContentCache::ContentCache(size_t capacityBytes) : capacityBytes(capacityBytes) {}
+
+void ContentCache::touch(const std::string &id, size_t bytes)
+{
+    auto it = index.find(id);
+    if (it != index.end())
+    {
+        totalBytes -= it->second->bytes;
+        entries.erase(it->second);
+    }
+    entries.push_front({id, bytes});
+    index[id] = entries.begin();
+    totalBytes += bytes;
+}
+
+void ContentCache::erase(const std::string &id)
+{
+    auto it = index.find(id);
+    if (it == index.end())
+        return;
+    totalBytes -= it->second->bytes;
+    entries.erase(it->second);
+    index.erase(it);
+}
+
+void ContentCache::clear()
+{
+    entries.clear();
+    index.clear();
+    totalBytes = 0;
+}
+
+std::vector<std::string> ContentCache::evict(const std::function<bool(const std::string &id)> &pinned)
+{
+    std::vector<std::string> evicted;
+    auto it = entries.end();
+    while (totalBytes > capacityBytes && it != entries.begin())
+    {
+        --it;
+        if (pinned(it->id))
+            continue;
+        evicted.push_back(it->id);
+        totalBytes -= it->bytes;
+        index.erase(it->id);
+        it = entries.erase(it);
+    }
+    return evicted;
+}
+
+size_t ContentCache::size() const { return totalBytes; }
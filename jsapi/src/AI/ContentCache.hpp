@@ -0,0 +1,53 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+// Tracks which nodes currently hold their content in memory, in least
+// recently used order, and picks the ones to unload once the total size
+// exceeds the capacity.
+class ContentCache
+{
+private:
+    struct Entry
+    {
+        std::string id;
+        size_t bytes;
+    };
+
+    size_t capacityBytes;
+    size_t totalBytes = 0;
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+public:
+    explicit ContentCache(size_t capacityBytes);
+
+    void touch(const std::string &id, size_t bytes);
+    void erase(const std::string &id);
+    void clear();
+    // Removes and returns the least recently used ids until the cache fits, skipping pinned ones
+    std::vector<std::string> evict(const std::function<bool(const std::string &id)> &pinned);
+
+    size_t size() const;
+};
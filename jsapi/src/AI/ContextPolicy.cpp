@@ -0,0 +1,73 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ContextPolicy.hpp"
+
+std::vector<const ConversationNode *> ContextPolicy::select(const std::vector<ConversationNode *> &path,
+                                                            const TokenEstimator &estimator,
+                                                            ContextReport &report) const
+{
+    size_t count = path.size();
+    std::vector<int64_t> tokens(count);
+    std::vector<bool> keep(count, false);
+    report = ContextReport();
+    report.totalMessages = count;
+
+    // A turn starts at a user message and runs until the next one
+    std::vector<size_t> turnStarts;
+    for (size_t i = 0; i < count; i++)
+    {
+        tokens[i] = estimator.estimateMessage(path[i]->content);
+        report.totalTokens += tokens[i];
+        if (path[i]->role == ConversationNode::ROLE_SYSTEM || path[i]->pinned)
+            keep[i] = true;
+        if (path[i]->role == ConversationNode::ROLE_USER || (turnStarts.empty() && path[i]->role != ConversationNode::ROLE_SYSTEM))
+            turnStarts.push_back(i);
+    }
+
+    int64_t used = 0;
+    for (size_t i = 0; i < count; i++)
+        if (keep[i])
+            used += tokens[i];
+
+    int turns = 0;
+    for (size_t turn = turnStarts.size(); turn-- > 0;)
+    {
+        size_t begin = turnStarts[turn];
+        size_t end = turn + 1 < turnStarts.size() ? turnStarts[turn + 1] : count;
+        int64_t turnTokens = 0;
+        for (size_t i = begin; i < end; i++)
+            if (!keep[i])
+                turnTokens += tokens[i];
+        bool newest = turn + 1 == turnStarts.size();
+        if (!newest && ((keepTurns > 0 && turns >= keepTurns) ||
+                        (maxPromptTokens > 0 && used + turnTokens > maxPromptTokens)))
+            break;
+        for (size_t i = begin; i < end; i++)
+            keep[i] = true;
+        used += turnTokens;
+        turns++;
+    }
+
+    std::vector<const ConversationNode *> selected;
+    for (size_t i = 0; i < count; i++)
+        if (keep[i])
+            selected.push_back(path[i]);
+    report.sentMessages = selected.size();
+    report.sentTokens = used;
+    return selected;
+}
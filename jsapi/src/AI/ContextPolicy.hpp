@@ -0,0 +1,47 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "ConversationNode.hpp"
+#include "TokenEstimator.hpp"
+
+struct ContextReport
+{
+    int64_t totalMessages = 0;
+    int64_t sentMessages = 0;
+    int64_t totalTokens = 0;
+    int64_t sentTokens = 0;
+    int64_t requestBytes = 0;
+};
+
+// Chooses which messages of the current path go into a chat request. System and pinned
+// messages and the newest turn are always sent; older turns are added newest first while
+// they fit both limits, and the first turn that does not fit ends the history.
+class ContextPolicy
+{
+public:
+    // 0 disables the limit
+    int64_t maxPromptTokens = 0;
+    int keepTurns = 0;
+
+    std::vector<const ConversationNode *> select(const std::vector<ConversationNode *> &path,
+                                                 const TokenEstimator &estimator,
+                                                 ContextReport &report) const;
+};
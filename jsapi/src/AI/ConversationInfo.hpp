@@ -28,7 +28,11 @@ struct ConversationInfo
     std::string title;
     long long createdAt;
     long long updatedAt;
+    int messageCount;
+    std::string lastSnippet;
 
-    ConversationInfo(std::string id, std::string title, long long createdAt, long long updatedAt)
-        : id(id), title(title), createdAt(createdAt), updatedAt(updatedAt) {}
+    ConversationInfo(std::string id, std::string title, long long createdAt, long long updatedAt,
+                     int messageCount = 0, std::string lastSnippet = "")
+        : id(id), title(title), createdAt(createdAt), updatedAt(updatedAt),
+          messageCount(messageCount), lastSnippet(lastSnippet) {}
 };
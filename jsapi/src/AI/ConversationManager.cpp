@@ -15,139 +15,241 @@
 // You should have received a copy of the GNU General Public License
 // along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
 
+
 #include "ConversationManager.hpp"
 #include "strUtils.hpp"
 #include <chrono>
+#include <iostream>
 #include <algorithm>
 #include <stdexcept>
 
-ConversationManager::ConversationManager() : database("/userdisk/database/langningchen-ai.db")
-{
-    database.table("conversations")
-        .column("id", TABLE::TEXT, TABLE::PRIMARY_KEY)
-        .column("title", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("created_at", TABLE::INTEGER, TABLE::NOT_NULL)
-        .column("updated_at", TABLE::INTEGER, TABLE::NOT_NULL)
-        .execute();
-    database.table("conversation_nodes")
-        .column("id", TABLE::TEXT, TABLE::PRIMARY_KEY)
-        .column("conversation_id", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("parent_id", TABLE::TEXT)
-        .column("role", TABLE::INTEGER, TABLE::NOT_NULL)
-        .column("content", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("stop_reason", TABLE::INTEGER, TABLE::NOT_NULL)
-        .column("created_at", TABLE::INTEGER, TABLE::NOT_NULL)
-        .execute();
-    database.table("api_settings")
-        .column("id", TABLE::TEXT, TABLE::PRIMARY_KEY)
-        .column("api_key", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("base_url", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("model", TABLE::TEXT)
-        .column("max_tokens", TABLE::INTEGER, TABLE::NOT_NULL)
-        .column("temperature", TABLE::REAL, TABLE::NOT_NULL)
-        .column("top_p", TABLE::REAL, TABLE::NOT_NULL)
-        .column("system_prompt", TABLE::TEXT, TABLE::NOT_NULL)
-        .execute();
+// An assistant reply without a stop reason is still being streamed; rows keep that
+// flag so a reload can tell a cut-off stream from replies stored before the flag existed
+static int isStreaming(const ConversationNode &node)
+{
+    return node.role == ConversationNode::ROLE_ASSISTANT && node.stopReason == ConversationNode::STOP_REASON_NONE ? 1 : 0;
 }
 
-std::vector<ConversationInfo> ConversationManager::getConversationList()
+ConversationManager::ConversationManager() : executor("/userdisk/database/langningchen-ai.db", DatabaseOptions::interactive())
+{
+    executor.post([this](DATABASE &database)
+                  { searchMode = ConversationSchema::create(database); });
+}
+
+SearchPage ConversationManager::searchMessages(const std::string &query, size_t limit, const SearchCursor *after)
+{
+    std::vector<std::string> terms = strUtils::split(query, " ");
+    if (terms.empty())
+        return {};
+    bool hasCursor = after != nullptr;
+    SearchCursor cursor = after ? *after : SearchCursor();
+    return executor.read([this, terms, limit, hasCursor, cursor](DATABASE &database)
+                         { return ConversationSchema::search(database, searchMode, terms, limit, hasCursor ? &cursor : nullptr); })
+        .get();
+}
+
+std::vector<ConversationInfo> ConversationManager::toConversationInfos(const std::vector<std::unordered_map<std::string, std::string>> &rows)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
     std::vector<ConversationInfo> conversations;
-    auto results = database.select("conversations")
-                       .select("id")
-                       .select("title")
-                       .select("created_at")
-                       .select("updated_at")
-                       .order("updated_at", false)
-                       .execute();
-    for (const auto &row : results)
+    conversations.reserve(rows.size());
+    for (const auto &row : rows)
         conversations.push_back(ConversationInfo(
             row.at("id"),
             row.at("title"),
             std::stoll(row.at("created_at")),
-            std::stoll(row.at("updated_at"))));
+            std::stoll(row.at("updated_at")),
+            std::stoi(row.at("message_count")),
+            row.at("last_snippet")));
     return conversations;
 }
 
+std::vector<ConversationInfo> ConversationManager::getConversationList()
+{
+    return executor.read([](DATABASE &database)
+                         { return toConversationInfos(database.select("conversations")
+                                                          .select("id")
+                                                          .select("title")
+                                                          .select("created_at")
+                                                          .select("updated_at")
+                                                          .select("message_count")
+                                                          .select("last_snippet")
+                                                          .order("updated_at", false)
+                                                          .order("id", false)
+                                                          .execute()); })
+        .get();
+}
+
+std::vector<ConversationInfo> ConversationManager::getConversationPage(size_t limit, const ConversationInfo *after)
+{
+    std::vector<std::string> cursor;
+    if (after)
+        cursor = {std::to_string(after->updatedAt), after->id};
+    return executor.read([limit, cursor](DATABASE &database)
+                         {
+                             // Walks idx_conversations_updated_at_id backwards, so a page costs the same at any depth
+                             auto query = database.select("conversations")
+                                              .select("id")
+                                              .select("title")
+                                              .select("created_at")
+                                              .select("updated_at")
+                                              .select("message_count")
+                                              .select("last_snippet")
+                                              .order("updated_at", false)
+                                              .order("id", false)
+                                              .limit(limit);
+                             if (!cursor.empty())
+                                 (void)query.before({"updated_at", "id"}, cursor);
+                             return toConversationInfos(query.execute()); })
+        .get();
+}
+
 void ConversationManager::createConversation(const std::string &title, std::string &outConversationId)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
     outConversationId = strUtils::randomId();
     auto currentTime = std::chrono::duration_cast<std::chrono::seconds>(
                            std::chrono::system_clock::now().time_since_epoch())
                            .count();
-    database.insert("conversations")
-        .value("id", outConversationId)
-        .value("title", title)
-        .value("created_at", currentTime)
-        .value("updated_at", currentTime)
-        .execute();
+    executor.submit([conversationId = outConversationId, title, currentTime](DATABASE &database)
+                    { database.insert("conversations")
+                          .value("id", conversationId)
+                          .value("title", title)
+                          .value("created_at", currentTime)
+                          .value("updated_at", currentTime)
+                          .execute(); })
+        .get();
 }
 void ConversationManager::deleteConversation(const std::string &conversationId)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
-    database.remove("conversation_nodes")
-        .where("conversation_id", conversationId)
-        .execute();
-    database.remove("conversations")
-        .where("id", conversationId)
-        .execute();
+    executor.submit([conversationId](DATABASE &database)
+                    { database.transaction([&]()
+                                           {
+                                               database.remove("conversation_nodes")
+                                                   .where("conversation_id", conversationId)
+                                                   .execute();
+                                               database.remove("conversations")
+                                                   .where("id", conversationId)
+                                                   .execute(); }); })
+        .get();
 }
 void ConversationManager::updateConversationTitle(const std::string &conversationId, const std::string &title)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
-    database.update("conversations")
-        .set("title", title)
-        .where("id", conversationId)
-        .execute();
+    executor.submit([conversationId, title](DATABASE &database)
+                    { database.update("conversations")
+                          .set("title", title)
+                          .where("id", conversationId)
+                          .execute(); })
+        .get();
 }
 
-void ConversationManager::saveConversation(const std::string &conversationId,
-                                           const std::unordered_map<std::string, std::unique_ptr<ConversationNode>> &nodeMap)
+void ConversationManager::saveChanges(const std::string &conversationId,
+                                      const std::vector<ConversationNode> &insertedNodes,
+                                      const std::vector<ConversationNode> &updatedNodes,
+                                      const std::vector<std::string> &deletedNodeIds,
+                                      std::function<void()> onFailed)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
     auto currentTime = std::chrono::duration_cast<std::chrono::seconds>(
                            std::chrono::system_clock::now().time_since_epoch())
                            .count();
 
-    database.update("conversations")
-        .set("updated_at", currentTime)
-        .where("id", conversationId)
-        .execute();
+    // Summary for the history list: net change in message count and a snippet of the newest text
+    int messageDelta = -(int)deletedNodeIds.size();
+    const ConversationNode *latest = nullptr;
+    for (const auto &node : insertedNodes)
+        if (node.role != ConversationNode::ROLE_SYSTEM)
+        {
+            messageDelta++;
+            if (!latest || node.timestamp >= latest->timestamp)
+                latest = &node;
+        }
+    for (const auto &node : updatedNodes)
+        if (node.role != ConversationNode::ROLE_SYSTEM && node.contentLoaded && (!latest || node.timestamp >= latest->timestamp))
+            latest = &node;
+    std::string snippet = latest ? strUtils::utf8Prefix(latest->content, ConversationSchema::SNIPPET_LENGTH) : "";
+    bool hasSnippet = latest != nullptr;
 
-    database.remove("conversation_nodes")
-        .where("conversation_id", conversationId)
-        .execute();
+    // Only touched rows are written, so the cost of a save no longer grows with the conversation
+    executor.post([conversationId, insertedNodes, updatedNodes, deletedNodeIds, currentTime, messageDelta, snippet, hasSnippet](DATABASE &database)
+                  { database.transaction([&]()
+                                         {
+                                             auto summary = database.prepare(hasSnippet
+                                                                                 ? "UPDATE conversations SET updated_at = ?, message_count = MAX(0, message_count + ?), last_snippet = ? WHERE id = ?"
+                                                                                 : "UPDATE conversations SET updated_at = ?, message_count = MAX(0, message_count + ?) WHERE id = ?");
+                                             int index = 1;
+                                             summary->bind(index++, (int64_t)currentTime);
+                                             summary->bind(index++, (int64_t)messageDelta);
+                                             if (hasSnippet)
+                                                 summary->bind(index++, snippet);
+                                             summary->bind(index++, conversationId);
+                                             summary->step();
 
-    for (const auto &pair : nodeMap)
-    {
-        const auto &node = pair.second;
-        if (!node)
-            continue;
-
-        database.insert("conversation_nodes")
-            .value("id", node->id)
-            .value("conversation_id", conversationId)
-            .value("parent_id", node->parentId)
-            .value("role", (int)node->role)
-            .value("content", node->content)
-            .value("stop_reason", (int)node->stopReason)
-            .value("created_at", currentTime)
-            .execute();
-    }
+                                             if (!deletedNodeIds.empty())
+                                             {
+                                                 database.remove("conversation_nodes")
+                                                     .whereIn("id", deletedNodeIds)
+                                                     .execute();
+                                                 // The snippet may have come from a deleted node; take the newest remaining one
+                                                 if (!hasSnippet)
+                                                     database.prepare("UPDATE conversations SET last_snippet = COALESCE((SELECT substr(content, 1, " +
+                                                                      std::to_string(ConversationSchema::SNIPPET_LENGTH) +
+                                                                      ") FROM conversation_nodes WHERE conversation_id = ?1 AND role != 2 "
+                                                                      "ORDER BY rowid DESC LIMIT 1), '') WHERE id = ?1")
+                                                         ->bind(1, conversationId)
+                                                         .step();
+                                             }
+
+                                             for (const auto &node : insertedNodes)
+                                                 database.insert("conversation_nodes")
+                                                     .value("id", node.id)
+                                                     .value("conversation_id", conversationId)
+                                                     .value("parent_id", node.parentId)
+                                                     .value("role", (int)node.role)
+                                                     .value("content", node.content)
+                                                     .value("stop_reason", (int)node.stopReason)
+                                                     .value("created_at", currentTime)
+                                                     .value("pinned", node.pinned ? 1 : 0)
+                                                     .value("streaming", isStreaming(node))
+                                                     .onConflict({"id"})
+                                                     .doUpdate("content")
+                                                     .doUpdate("stop_reason")
+                                                     .doUpdate("pinned")
+                                                     .doUpdate("streaming")
+                                                     .execute();
+
+                                             for (const auto &node : updatedNodes)
+                                             {
+                                                 UPDATE update = database.update("conversation_nodes");
+                                                 // Without its content loaded the node only knows an empty string,
+                                                 // which must not overwrite the stored text
+                                                 if (node.contentLoaded)
+                                                     (void)update.set("content", node.content);
+                                                 update.set("stop_reason", (int)node.stopReason)
+                                                     .set("pinned", node.pinned ? 1 : 0)
+                                                     .set("streaming", isStreaming(node))
+                                                     .where("id", node.id)
+                                                     .execute();
+                                             } }); },
+                  [onFailed](const std::exception &)
+                  { onFailed(); });
 }
 void ConversationManager::loadConversation(const std::string &conversationId,
                                            std::unordered_map<std::string, std::unique_ptr<ConversationNode>> &nodeMap,
                                            std::string &rootNodeId, std::string &leafNodeId)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
     nodeMap.clear();
     rootNodeId.clear();
 
-    auto nodeResults = database.select("conversation_nodes")
-                           .where("conversation_id", conversationId)
-                           .execute();
+    // Only the tree skeleton is read here; content is fetched per node by loadContents
+    auto nodeResults = executor.read([conversationId](DATABASE &database)
+                                     { return database.select("conversation_nodes")
+                                           .select("id")
+                                           .select("parent_id")
+                                           .select("role")
+                                           .select("stop_reason")
+                                           .select("pinned")
+                                           .select("streaming")
+                                           .where("conversation_id", conversationId)
+                                           .execute(); })
+                           .get();
 
     std::unordered_map<std::string, std::vector<std::string>> parentToChildren;
 
@@ -156,11 +258,15 @@ void ConversationManager::loadConversation(const std::string &conversationId,
         std::string nodeId = row.at("id");
         std::string parentId = row.at("parent_id");
         int role = std::stoi(row.at("role"));
-        std::string content = row.at("content");
         int stopReason = row.count("stop_reason") ? std::stoi(row.at("stop_reason")) : 6; // Default to STOP_REASON_NONE
+        // Finished replies always get a stop reason, so a row still marked streaming was cut off by a crash
+        if (row.at("streaming") == "1")
+            stopReason = ConversationNode::STOP_REASON_ERROR;
 
         nodeMap[nodeId] = std::make_unique<ConversationNode>(
-            nodeId, static_cast<ConversationNode::ROLE>(role), content, parentId, static_cast<ConversationNode::STOP_REASON>(stopReason));
+            nodeId, static_cast<ConversationNode::ROLE>(role), "", parentId, static_cast<ConversationNode::STOP_REASON>(stopReason));
+        nodeMap[nodeId]->contentLoaded = false;
+        nodeMap[nodeId]->pinned = row.at("pinned") == "1";
 
         if (!parentId.empty())
             parentToChildren[parentId].push_back(nodeId);
@@ -177,32 +283,66 @@ void ConversationManager::loadConversation(const std::string &conversationId,
         leafNodeId = nodeMap[leafNodeId]->childIds.back();
 }
 
+std::unordered_map<std::string, std::string> ConversationManager::loadContents(const std::vector<std::string> &nodeIds)
+{
+    if (nodeIds.empty())
+        return {};
+    return executor.read([nodeIds](DATABASE &database)
+                         {
+                             std::unordered_map<std::string, std::string> contents;
+                             // Stay below the bound parameter limit of older SQLite builds
+                             const size_t batchSize = 500;
+                             for (size_t begin = 0; begin < nodeIds.size(); begin += batchSize)
+                             {
+                                 std::vector<std::string> batch(nodeIds.begin() + begin,
+                                                                nodeIds.begin() + std::min(begin + batchSize, nodeIds.size()));
+                                 auto results = database.select("conversation_nodes")
+                                                    .select("id")
+                                                    .select("content")
+                                                    .whereIn("id", batch)
+                                                    .execute();
+                                 for (const auto &row : results)
+                                     contents[row.at("id")] = row.at("content");
+                             }
+                             return contents; })
+        .get();
+}
+
 void ConversationManager::saveApiSettings(const std::string &apiKey, const std::string &baseUrl,
                                           const std::string &model, int maxTokens,
                                           double temperature, double topP, const std::string &systemPrompt)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
-    database.remove("api_settings").execute();
-    database.insert("api_settings")
-        .value("id", "default")
-        .value("api_key", apiKey)
-        .value("base_url", baseUrl)
-        .value("model", model)
-        .value("max_tokens", maxTokens)
-        .value("temperature", temperature)
-        .value("top_p", topP)
-        .value("system_prompt", systemPrompt)
-        .execute();
+    executor.submit([=](DATABASE &database)
+                    { database.insert("api_settings")
+                          .value("id", "default")
+                          .value("api_key", apiKey)
+                          .value("base_url", baseUrl)
+                          .value("model", model)
+                          .value("max_tokens", maxTokens)
+                          .value("temperature", temperature)
+                          .value("top_p", topP)
+                          .value("system_prompt", systemPrompt)
+                          .onConflict({"id"})
+                          .doUpdate("api_key")
+                          .doUpdate("base_url")
+                          .doUpdate("model")
+                          .doUpdate("max_tokens")
+                          .doUpdate("temperature")
+                          .doUpdate("top_p")
+                          .doUpdate("system_prompt")
+                          .execute(); })
+        .get();
 }
 
 void ConversationManager::loadApiSettings(std::string &apiKey, std::string &baseUrl,
                                           std::string &model, int &maxTokens,
                                           double &temperature, double &topP, std::string &systemPrompt)
 {
-    std::lock_guard<std::mutex> lock(dbMutex);
-    auto results = database.select("api_settings")
-                       .where("id", "default")
-                       .execute();
+    auto results = executor.read([](DATABASE &database)
+                                 { return database.select("api_settings")
+                                       .where("id", "default")
+                                       .execute(); })
+                       .get();
 
     if (!results.empty())
     {
@@ -216,3 +356,32 @@ void ConversationManager::loadApiSettings(std::string &apiKey, std::string &base
         systemPrompt = row.at("system_prompt");
     }
 }
+
+void ConversationManager::saveEndpoints(const std::vector<AIEndpoint> &endpoints)
+{
+    executor.submit([endpoints](DATABASE &database)
+                    { database.transaction([&]()
+                                           {
+                                               database.remove("api_endpoints").execute();
+                                               for (size_t i = 0; i < endpoints.size(); i++)
+                                                   database.insert("api_endpoints")
+                                                       .value("position", (int)i)
+                                                       .value("base_url", endpoints[i].baseUrl)
+                                                       .value("api_key", endpoints[i].apiKey)
+                                                       .execute(); }); })
+        .get();
+}
+
+std::vector<AIEndpoint> ConversationManager::loadEndpoints()
+{
+    auto results = executor.read([](DATABASE &database)
+                                 { return database.select("api_endpoints")
+                                       .order("position", true)
+                                       .execute(); })
+                       .get();
+
+    std::vector<AIEndpoint> endpoints;
+    for (const auto &row : results)
+        endpoints.push_back(AIEndpoint{row.at("base_url"), row.at("api_key")});
+    return endpoints;
+}
@@ -20,32 +20,46 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
 #include <unordered_map>
-#include <mutex>
-#include "Database/Database.hpp"
+#include "Database/DatabaseExecutor.hpp"
 #include "ConversationNode.hpp"
+#include "ConversationSchema.hpp"
 #include "ConversationInfo.hpp"
+#include "SearchResult.hpp"
+#include "AIEndpoint.hpp"
 
 class ConversationManager
 {
 private:
-    DATABASE database;
-    mutable std::mutex dbMutex;
+    DatabaseExecutor executor;
+    // Only touched on the executor thread
+    ConversationSchema::SEARCH_MODE searchMode = ConversationSchema::SEARCH_LIKE;
+
+    static std::vector<ConversationInfo> toConversationInfos(const std::vector<std::unordered_map<std::string, std::string>> &rows);
 
 public:
     ConversationManager();
     ~ConversationManager() = default;
 
     std::vector<ConversationInfo> getConversationList();
+    // Newest first; pass the last item of the previous page as the cursor to continue
+    std::vector<ConversationInfo> getConversationPage(size_t limit, const ConversationInfo *after = nullptr);
     void createConversation(const std::string &title, std::string &outConversationId);
     void deleteConversation(const std::string &conversationId);
     void updateConversationTitle(const std::string &conversationId, const std::string &title);
 
-    void saveConversation(const std::string &conversationId,
-                          const std::unordered_map<std::string, std::unique_ptr<ConversationNode>> &nodeMap);
+    // Written in the background; onFailed runs on the database thread if the write is rolled back
+    void saveChanges(const std::string &conversationId,
+                     const std::vector<ConversationNode> &insertedNodes,
+                     const std::vector<ConversationNode> &updatedNodes,
+                     const std::vector<std::string> &deletedNodeIds,
+                     std::function<void()> onFailed);
     void loadConversation(const std::string &conversationId,
                           std::unordered_map<std::string, std::unique_ptr<ConversationNode>> &nodeMap,
                           std::string &rootNodeId, std::string &leafNodeId);
+    std::unordered_map<std::string, std::string> loadContents(const std::vector<std::string> &nodeIds);
+    SearchPage searchMessages(const std::string &query, size_t limit, const SearchCursor *after = nullptr);
 
     void saveApiSettings(const std::string &apiKey, const std::string &baseUrl,
                          const std::string &model, int maxTokens,
@@ -53,4 +67,6 @@ public:
     void loadApiSettings(std::string &apiKey, std::string &baseUrl,
                          std::string &model, int &maxTokens,
                          double &temperature, double &topP, std::string &systemPrompt);
+    void saveEndpoints(const std::vector<AIEndpoint> &endpoints);
+    std::vector<AIEndpoint> loadEndpoints();
 };
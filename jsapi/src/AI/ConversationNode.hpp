@@ -46,6 +46,12 @@ struct ConversationNode
     std::string parentId;
     std::vector<std::string> childIds;
     int64_t timestamp;
+    // In-memory revision of the last change, see AI::getPathChanges
+    uint64_t version = 0;
+    // False while only the skeleton is loaded or after the content was evicted, see AI::loadContent
+    bool contentLoaded = true;
+    // Always sent with chat requests, see ContextPolicy
+    bool pinned = false;
 
     ConversationNode(std::string id, ROLE role, std::string content, std::string parentId, STOP_REASON stopReason = STOP_REASON_NONE)
         : id(id), role(role), stopReason(stopReason), content(content), parentId(parentId),
@@ -0,0 +1,274 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ConversationSchema.hpp"
+#include "strUtils.hpp"
+#include <iostream>
+
+ConversationSchema::SEARCH_MODE ConversationSchema::create(DATABASE &database)
+{
+    auto summaryColumns = database.table("conversations")
+        .column("id", TABLE::TEXT, TABLE::PRIMARY_KEY)
+        .column("title", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("created_at", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("updated_at", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("message_count", TABLE::INTEGER, TABLE::NOT_NULL | TABLE::DEFAULT, "0")
+        .column("last_snippet", TABLE::TEXT, TABLE::NOT_NULL | TABLE::DEFAULT, "")
+        .index("idx_conversations_updated_at_id", {"updated_at", "id"})
+        .execute();
+    bool migrated = migrateNodeRowids(database);
+    nodesTable(database, "conversation_nodes")
+        .index("idx_conversation_nodes_conversation_id", {"conversation_id"})
+        .execute();
+    if (!summaryColumns.empty())
+    {
+        // Conversations stored before summaries existed get theirs computed once
+        database.prepare("DROP INDEX IF EXISTS idx_conversations_updated_at")->step();
+        database.prepare("UPDATE conversations SET "
+                         "message_count = (SELECT COUNT(*) FROM conversation_nodes n "
+                         "WHERE n.conversation_id = conversations.id AND n.role != 2), "
+                         "last_snippet = COALESCE((SELECT substr(n.content, 1, " +
+                         std::to_string(SNIPPET_LENGTH) +
+                         ") FROM conversation_nodes n "
+                         "WHERE n.conversation_id = conversations.id AND n.role != 2 "
+                         "ORDER BY n.rowid DESC LIMIT 1), '')")
+            ->step();
+    }
+    database.table("api_settings")
+        .column("id", TABLE::TEXT, TABLE::PRIMARY_KEY)
+        .column("api_key", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("base_url", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("model", TABLE::TEXT)
+        .column("max_tokens", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("temperature", TABLE::REAL, TABLE::NOT_NULL)
+        .column("top_p", TABLE::REAL, TABLE::NOT_NULL)
+        .column("system_prompt", TABLE::TEXT, TABLE::NOT_NULL)
+        .execute();
+    database.table("api_endpoints")
+        .column("position", TABLE::INTEGER, TABLE::PRIMARY_KEY)
+        .column("base_url", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("api_key", TABLE::TEXT, TABLE::NOT_NULL)
+        .execute();
+    return setupSearch(database, migrated);
+}
+
+// "seq" aliases the rowid, which conversation_nodes_fts refers to nodes by; VACUUM
+// keeps the rowids of a table only when they have such an INTEGER PRIMARY KEY
+TABLE ConversationSchema::nodesTable(DATABASE &database, const std::string &tableName)
+{
+    return database.table(tableName)
+        .column("seq", TABLE::INTEGER, TABLE::PRIMARY_KEY)
+        .column("id", TABLE::TEXT, TABLE::NOT_NULL | TABLE::UNIQUE)
+        .column("conversation_id", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("parent_id", TABLE::TEXT)
+        .column("role", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("content", TABLE::TEXT, TABLE::NOT_NULL)
+        .column("stop_reason", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("created_at", TABLE::INTEGER, TABLE::NOT_NULL)
+        .column("pinned", TABLE::INTEGER, TABLE::NOT_NULL | TABLE::DEFAULT, "0")
+        .column("streaming", TABLE::INTEGER, TABLE::NOT_NULL | TABLE::DEFAULT, "0");
+}
+// Copies a conversation_nodes table from before "seq" existed into one that has it,
+// keeping every rowid; returns whether it did
+bool ConversationSchema::migrateNodeRowids(DATABASE &database)
+{
+    std::vector<std::string> columns;
+    bool hasSeq = false;
+    auto tableInfo = database.prepare("PRAGMA table_info(conversation_nodes)");
+    while (tableInfo->step())
+    {
+        columns.push_back(tableInfo->columnText(1));
+        hasSeq |= columns.back() == "seq";
+    }
+    if (columns.empty() || hasSeq)
+        return false;
+
+    std::string columnList;
+    for (const auto &column : columns)
+        columnList += (columnList.empty() ? "" : ", ") + column;
+    database.transaction([&]()
+                         {
+                             nodesTable(database, "conversation_nodes_migrated").execute();
+                             database.prepare("INSERT INTO conversation_nodes_migrated (seq, " + columnList + ") SELECT rowid, " +
+                                              columnList + " FROM conversation_nodes")
+                                 ->step();
+                             // Takes the old index and triggers with it; both are created again afterwards
+                             database.prepare("DROP TABLE conversation_nodes")->step();
+                             database.prepare("ALTER TABLE conversation_nodes_migrated RENAME TO conversation_nodes")->step(); });
+    return true;
+}
+
+// Keeps an external-content FTS5 index over conversation_nodes.content in sync through
+// triggers. The trigram tokenizer is preferred because unicode61 cannot split Chinese
+// text into words; builds without FTS5 fall back to LIKE scans.
+ConversationSchema::SEARCH_MODE ConversationSchema::setupSearch(DATABASE &database, bool rebuild)
+{
+    auto existing = database.prepare("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'conversation_nodes_fts'");
+    bool created = !existing->step();
+    SEARCH_MODE mode = SEARCH_LIKE;
+    if (created)
+    {
+        for (auto [tokenizer, tokenizerMode] : {std::pair{"trigram", SEARCH_FTS_TRIGRAM}, std::pair{"unicode61", SEARCH_FTS}})
+            try
+            {
+                database.prepare(std::string("CREATE VIRTUAL TABLE conversation_nodes_fts USING fts5(content, content = 'conversation_nodes', "
+                                             "content_rowid = 'rowid', tokenize = '") +
+                                 tokenizer + "')")
+                    ->step();
+                mode = tokenizerMode;
+                break;
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "FTS5 " << tokenizer << " unavailable: " << e.what() << std::endl;
+            }
+        if (mode == SEARCH_LIKE)
+            return mode;
+    }
+    else
+        mode = existing->columnText(0).find("trigram") != std::string::npos ? SEARCH_FTS_TRIGRAM : SEARCH_FTS;
+
+    database.prepare("CREATE TRIGGER IF NOT EXISTS conversation_nodes_fts_insert AFTER INSERT ON conversation_nodes BEGIN "
+                     "INSERT INTO conversation_nodes_fts (rowid, content) VALUES (new.rowid, new.content); END")
+        ->step();
+    database.prepare("CREATE TRIGGER IF NOT EXISTS conversation_nodes_fts_delete AFTER DELETE ON conversation_nodes BEGIN "
+                     "INSERT INTO conversation_nodes_fts (conversation_nodes_fts, rowid, content) VALUES ('delete', old.rowid, old.content); END")
+        ->step();
+    database.prepare("CREATE TRIGGER IF NOT EXISTS conversation_nodes_fts_update AFTER UPDATE OF content ON conversation_nodes BEGIN "
+                     "INSERT INTO conversation_nodes_fts (conversation_nodes_fts, rowid, content) VALUES ('delete', old.rowid, old.content); "
+                     "INSERT INTO conversation_nodes_fts (rowid, content) VALUES (new.rowid, new.content); END")
+        ->step();
+    // A migrated table may have been vacuumed before it had "seq", so its index is rebuilt once too
+    if (created || rebuild)
+        database.prepare("INSERT INTO conversation_nodes_fts (conversation_nodes_fts) VALUES ('rebuild')")->step();
+    return mode;
+}
+
+// Cuts about `radius` characters either side of the first match out of content for the LIKE fallback
+static std::string likeSnippet(const std::string &content, const std::string &term, size_t radius)
+{
+    size_t match = content.find(term);
+    if (match == std::string::npos)
+        return strUtils::utf8Prefix(content, radius * 2);
+    size_t begin = match, characters = 0;
+    while (begin > 0 && characters < radius)
+    {
+        begin--;
+        if (((unsigned char)content[begin] & 0xC0) != 0x80)
+            characters++;
+    }
+    std::string before = content.substr(begin, match - begin);
+    std::string after = strUtils::utf8Prefix(content.substr(match + term.size()), radius);
+    return (begin > 0 ? "…" : "") + before + "【" + term + "】" + after +
+           (match + term.size() + after.size() < content.size() ? "…" : "");
+}
+
+SearchPage ConversationSchema::search(DATABASE &database, SEARCH_MODE mode, const std::vector<std::string> &terms,
+                                      size_t limit, const SearchCursor *after)
+{
+    SearchPage page;
+    // Trigram tokens need at least three characters per term to match
+    bool useFts = mode != SEARCH_LIKE;
+    if (mode == SEARCH_FTS_TRIGRAM)
+        for (const auto &term : terms)
+            if (strUtils::utf8Prefix(term, 2) == term)
+                useFts = false;
+
+    if (useFts)
+    {
+        std::string match;
+        for (const auto &term : terms)
+        {
+            std::string quoted;
+            for (char c : term)
+                quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+            match += (match.empty() ? "\"" : " \"") + quoted + "\"";
+        }
+        // Keyset over (score, rowid), so a later page does not re-rank the ones before it
+        auto stmt = database.prepare(
+            std::string("SELECT n.conversation_id, c.title, n.id, n.role, "
+                        "snippet(conversation_nodes_fts, 0, '【', '】', '…', 16), bm25(conversation_nodes_fts) AS score, n.rowid "
+                        "FROM conversation_nodes_fts "
+                        "JOIN conversation_nodes n ON n.rowid = conversation_nodes_fts.rowid "
+                        "JOIN conversations c ON c.id = n.conversation_id "
+                        "WHERE conversation_nodes_fts MATCH ? AND n.role != 2 ") +
+            (after ? "AND (score > ? OR (score = ? AND n.rowid > ?)) " : "") +
+            "ORDER BY score, n.rowid LIMIT ?");
+        stmt->bind(1, match);
+        if (after)
+            stmt->bind(2, after->rank).bind(3, after->rank).bind(4, after->seq);
+        stmt->bind(after ? 5 : 2, (int64_t)limit);
+        while (stmt->step())
+            page.items.push_back({stmt->columnText(0), stmt->columnText(1), stmt->columnText(2),
+                                  (ConversationNode::ROLE)stmt->columnInt(3), stmt->columnText(4), stmt->columnDouble(5),
+                                  stmt->columnInt(6)});
+        if (page.items.size() == limit)
+        {
+            page.hasMore = true;
+            page.next = {page.items.back().rank, page.items.back().seq};
+        }
+        return page;
+    }
+
+    // Without an index every LIKE reads whole messages, so each page looks at no more
+    // than LIKE_SCAN_ROWS rowids below the cursor; an unfinished window is flagged partial
+    int64_t upper = after ? after->seq : 0;
+    if (!after)
+    {
+        auto last = database.prepare("SELECT COALESCE(MAX(rowid), 0) + 1 FROM conversation_nodes");
+        last->step();
+        upper = last->columnInt(0);
+    }
+    int64_t lower = std::max<int64_t>(upper - LIKE_SCAN_ROWS, 0);
+    std::string sql = "SELECT n.conversation_id, c.title, n.id, n.role, n.content, n.rowid "
+                      "FROM conversation_nodes n JOIN conversations c ON c.id = n.conversation_id "
+                      "WHERE n.rowid < ? AND n.rowid >= ? AND n.role != 2";
+    for (size_t i = 0; i < terms.size(); i++)
+        sql += " AND n.content LIKE ? ESCAPE '\\'";
+    sql += " ORDER BY n.rowid DESC LIMIT ?";
+    auto stmt = database.prepare(sql);
+    stmt->bind(1, upper).bind(2, lower);
+    int index = 3;
+    for (const auto &term : terms)
+    {
+        std::string pattern = "%";
+        for (char c : term)
+        {
+            if (c == '%' || c == '_' || c == '\\')
+                pattern += '\\';
+            pattern += c;
+        }
+        stmt->bind(index++, pattern + "%");
+    }
+    stmt->bind(index, (int64_t)limit);
+    while (stmt->step())
+        page.items.push_back({stmt->columnText(0), stmt->columnText(1), stmt->columnText(2),
+                              (ConversationNode::ROLE)stmt->columnInt(3),
+                              likeSnippet(stmt->columnText(4), terms.front(), 16), 0, stmt->columnInt(5)});
+    if (page.items.size() == limit)
+    {
+        page.hasMore = true;
+        page.next = {0, page.items.back().seq};
+    }
+    else if (lower > 0)
+    {
+        page.hasMore = true;
+        page.partial = true;
+        page.next = {0, lower};
+    }
+    return page;
+}
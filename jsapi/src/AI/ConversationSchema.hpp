@@ -0,0 +1,52 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "Database/Database.hpp"
+#include "SearchResult.hpp"
+#include <string>
+#include <vector>
+
+// Tables, indexes and migrations of the conversation database, and the message search
+// that depends on them. Written against a plain DATABASE, so tests run exactly what
+// ConversationManager runs on its executor
+class ConversationSchema
+{
+public:
+    enum SEARCH_MODE
+    {
+        SEARCH_LIKE,
+        SEARCH_FTS,
+        SEARCH_FTS_TRIGRAM,
+    };
+    // Characters of the newest message kept in conversations.last_snippet
+    static const size_t SNIPPET_LENGTH = 60;
+    // Message rowids one page of a LIKE search looks at
+    static const int64_t LIKE_SCAN_ROWS = 2000;
+
+    // Creates or upgrades every table; returns how messages can be searched
+    static SEARCH_MODE create(DATABASE &database);
+    // Messages containing every term, best match first for FTS and newest first for LIKE
+    static SearchPage search(DATABASE &database, SEARCH_MODE mode, const std::vector<std::string> &terms,
+                             size_t limit, const SearchCursor *after = nullptr);
+
+private:
+    static TABLE nodesTable(DATABASE &database, const std::string &tableName);
+    static bool migrateNodeRowids(DATABASE &database);
+    static SEARCH_MODE setupSearch(DATABASE &database, bool rebuild);
+};
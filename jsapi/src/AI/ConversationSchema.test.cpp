@@ -0,0 +1,143 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+// Pages through message searches on the real schema with the keyset cursor:
+// every match must come back exactly once, in order, on both the FTS path and
+// the bounded LIKE fallback that short keywords use.
+
+#include "ConversationSchema.hpp"
+#include <iostream>
+#include <set>
+#include <vector>
+
+static const int MESSAGES = 4500;
+
+// Follows nextCursor until the search is exhausted; returns the node ids in page order,
+// or nothing when they are not newest first (LIKE) or best first (FTS)
+static std::vector<std::string> searchAll(DATABASE &database, ConversationSchema::SEARCH_MODE mode, const std::vector<std::string> &terms,
+                                          size_t limit, bool newestFirst, int &pages, int &partialPages)
+{
+    std::vector<std::string> ids;
+    std::vector<SearchResult> results;
+    pages = partialPages = 0;
+    SearchPage page = ConversationSchema::search(database, mode, terms, limit);
+    while (true)
+    {
+        pages++;
+        partialPages += page.partial;
+        for (const auto &result : page.items)
+        {
+            ids.push_back(result.nodeId);
+            results.push_back(result);
+        }
+        if (!page.hasMore)
+            break;
+        // A cursor that does not advance would page forever
+        if (pages > MESSAGES)
+        {
+            std::cerr << "FAIL: the cursor does not advance" << std::endl;
+            return {};
+        }
+        page = ConversationSchema::search(database, mode, terms, limit, &page.next);
+    }
+    for (size_t i = 1; i < results.size(); i++)
+    {
+        const SearchResult &previous = results[i - 1], &current = results[i];
+        bool ordered = newestFirst
+                           ? current.seq < previous.seq
+                           : previous.rank < current.rank || (previous.rank == current.rank && previous.seq < current.seq);
+        if (!ordered)
+        {
+            std::cerr << "FAIL: " << current.nodeId << " out of order" << std::endl;
+            return {};
+        }
+    }
+    return ids;
+}
+
+static int expectAll(const std::string &name, const std::vector<std::string> &ids, const std::set<std::string> &expected)
+{
+    std::set<std::string> unique(ids.begin(), ids.end());
+    if (unique.size() != ids.size() || unique != expected)
+    {
+        std::cerr << "FAIL: " << name << " returned " << ids.size() << " results (" << unique.size()
+                  << " distinct), expected " << expected.size() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main()
+{
+    DATABASE database(":memory:");
+    ConversationSchema::SEARCH_MODE mode = ConversationSchema::create(database);
+    if (mode != ConversationSchema::SEARCH_FTS_TRIGRAM)
+    {
+        std::cerr << "FAIL: this SQLite has no FTS5 trigram tokenizer" << std::endl;
+        return 1;
+    }
+
+    // Every 7th message mentions "apple" (more often in some), every 100th "你好"; system prompts never match
+    std::set<std::string> apples, greetings;
+    database.transaction([&]()
+                         {
+                             database.prepare("INSERT INTO conversations (id, title, created_at, updated_at) VALUES ('c', 't', 0, 0)")->step();
+                             auto insert = database.prepare("INSERT INTO conversation_nodes (id, conversation_id, parent_id, role, content, stop_reason, created_at) "
+                                                            "VALUES (?, 'c', NULL, ?, ?, 1, 0)");
+                             for (int i = 0; i < MESSAGES; i++)
+                             {
+                                 std::string id = "n" + std::to_string(i);
+                                 int role = i % 50 == 0 ? ConversationNode::ROLE_SYSTEM : i % 2;
+                                 std::string content = "message " + std::to_string(i);
+                                 if (i % 7 == 0)
+                                     content += i % 3 == 0 ? " apple apple" : " an apple";
+                                 if (i % 100 == 1)
+                                     content += " 你好";
+                                 insert->reset();
+                                 insert->bind(1, id).bind(2, (int64_t)role).bind(3, content);
+                                 insert->step();
+                                 if (role != ConversationNode::ROLE_SYSTEM && i % 7 == 0)
+                                     apples.insert(id);
+                                 if (role != ConversationNode::ROLE_SYSTEM && i % 100 == 1)
+                                     greetings.insert(id);
+                             } });
+
+    int failures = 0, pages, partialPages;
+    auto ids = searchAll(database, mode, {"apple"}, 25, false, pages, partialPages);
+    failures += expectAll("FTS search", ids, apples);
+    if (partialPages != 0)
+    {
+        std::cerr << "FAIL: FTS pages flagged partial" << std::endl;
+        failures++;
+    }
+
+    // Two characters are too short for trigrams, so this takes the LIKE fallback; a scan
+    // window holds fewer matches than a page, so every window but the last is partial
+    ids = searchAll(database, mode, {"你好"}, 30, true, pages, partialPages);
+    failures += expectAll("LIKE search", ids, greetings);
+    int windows = (MESSAGES + ConversationSchema::LIKE_SCAN_ROWS - 1) / ConversationSchema::LIKE_SCAN_ROWS;
+    if (partialPages != windows - 1 || pages != windows)
+    {
+        std::cerr << "FAIL: LIKE search took " << pages << " pages, " << partialPages << " partial" << std::endl;
+        failures++;
+    }
+
+    // The LIKE path with no FTS at all pages the same way
+    ids = searchAll(database, ConversationSchema::SEARCH_LIKE, {"apple"}, 25, true, pages, partialPages);
+    failures += expectAll("LIKE-only search", ids, apples);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "EndpointRouter.hpp"
+#include <algorithm>
+
+std::vector<AIEndpoint> EndpointRouter::rank(const std::vector<AIEndpoint> &endpoints)
+{
+    struct Candidate
+    {
+        bool available;
+        bool measured;
+        double score;
+        const AIEndpoint *endpoint;
+    };
+    auto now = std::chrono::steady_clock::now();
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &endpoint : endpoints)
+        {
+            const Entry &entry = entries[endpoint.baseUrl];
+            candidates.push_back(Candidate{now >= entry.retryAt,
+                                           entry.health.measured,
+                                           entry.health.latencyMs * (1 + 4 * entry.health.errorRate),
+                                           &endpoint});
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+                     {
+                         if (a.available != b.available)
+                             return a.available;
+                         if (a.measured != b.measured)
+                             return a.measured;
+                         return a.measured && a.score < b.score; });
+    std::vector<AIEndpoint> ranked;
+    for (const auto &candidate : candidates)
+        ranked.push_back(*candidate.endpoint);
+    return ranked;
+}
+
+std::vector<AIEndpoint> EndpointRouter::dueForProbe(const std::vector<AIEndpoint> &endpoints)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto interval = std::chrono::milliseconds(PROBE_INTERVAL_MS);
+    std::vector<AIEndpoint> due;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &endpoint : endpoints)
+    {
+        Entry &entry = entries[endpoint.baseUrl];
+        if (entry.health.measured && now - entry.lastSample < interval)
+            continue;
+        if (entry.lastProbe.time_since_epoch().count() != 0 && now - entry.lastProbe < interval)
+            continue;
+        entry.lastProbe = now;
+        due.push_back(endpoint);
+    }
+    return due;
+}
+
+void EndpointRouter::succeeded(const std::string &baseUrl, double latencyMs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[baseUrl];
+    EndpointHealth &health = entry.health;
+    health.requests++;
+    health.errorRate *= 1 - ERROR_WEIGHT;
+    health.consecutiveFailures = 0;
+    entry.retryAt = {};
+    if (latencyMs < 0)
+        return;
+    health.latencyMs = health.measured ? health.latencyMs + LATENCY_WEIGHT * (latencyMs - health.latencyMs) : latencyMs;
+    health.measured = true;
+    entry.lastSample = std::chrono::steady_clock::now();
+}
+
+void EndpointRouter::failed(const std::string &baseUrl)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[baseUrl];
+    EndpointHealth &health = entry.health;
+    health.requests++;
+    health.failures++;
+    health.errorRate += ERROR_WEIGHT * (1 - health.errorRate);
+    int64_t cooldownMs = BASE_COOLDOWN_MS;
+    for (int i = 0; i < health.consecutiveFailures && cooldownMs < MAX_COOLDOWN_MS; i++)
+        cooldownMs *= 2;
+    health.consecutiveFailures++;
+    entry.retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::min<int64_t>(cooldownMs, MAX_COOLDOWN_MS));
+}
+
+std::vector<EndpointHealth> EndpointRouter::health(const std::vector<AIEndpoint> &endpoints) const
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<EndpointHealth> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &endpoint : endpoints)
+    {
+        EndpointHealth health;
+        auto it = entries.find(endpoint.baseUrl);
+        if (it != entries.end())
+        {
+            health = it->second.health;
+            if (it->second.retryAt > now)
+                health.cooldownMs = std::chrono::duration_cast<std::chrono::milliseconds>(it->second.retryAt - now).count();
+        }
+        health.baseUrl = endpoint.baseUrl;
+        result.push_back(health);
+    }
+    return result;
+}
+
+bool EndpointRouter::retryable(int status)
+{
+    return status == 408 || status == 429 || status >= 500;
+}
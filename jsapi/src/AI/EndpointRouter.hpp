@@ -0,0 +1,76 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "AIEndpoint.hpp"
+
+struct EndpointHealth
+{
+    std::string baseUrl;
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    // Moving averages; latency is the time to the first response byte
+    double latencyMs = 0;
+    double errorRate = 0;
+    bool measured = false;
+    int consecutiveFailures = 0;
+    // Milliseconds until the endpoint is tried again after failing; 0 when available
+    int64_t cooldownMs = 0;
+};
+
+// Orders the configured endpoints by recent latency and error rate. An endpoint that
+// fails is skipped for a backoff period that doubles with each consecutive failure;
+// until an endpoint has been measured, the configured order decides.
+class EndpointRouter
+{
+private:
+    struct Entry
+    {
+        EndpointHealth health;
+        std::chrono::steady_clock::time_point retryAt;
+        std::chrono::steady_clock::time_point lastSample;
+        std::chrono::steady_clock::time_point lastProbe;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    mutable std::mutex mutex;
+
+public:
+    static constexpr double LATENCY_WEIGHT = 0.3;
+    static constexpr double ERROR_WEIGHT = 0.2;
+    static constexpr int PROBE_INTERVAL_MS = 60 * 1000;
+    static constexpr int BASE_COOLDOWN_MS = 5 * 1000;
+    static constexpr int MAX_COOLDOWN_MS = 5 * 60 * 1000;
+
+    std::vector<AIEndpoint> rank(const std::vector<AIEndpoint> &endpoints);
+    // Endpoints without a sample in the last PROBE_INTERVAL_MS, each returned at most once per interval
+    std::vector<AIEndpoint> dueForProbe(const std::vector<AIEndpoint> &endpoints);
+    // latencyMs < 0 counts the success without a latency sample
+    void succeeded(const std::string &baseUrl, double latencyMs);
+    void failed(const std::string &baseUrl);
+    std::vector<EndpointHealth> health(const std::vector<AIEndpoint> &endpoints) const;
+
+    // Statuses worth trying on another endpoint
+    static bool retryable(int status);
+};
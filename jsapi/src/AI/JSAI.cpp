@@ -17,49 +17,122 @@
 
 #include "JSAI.hpp"
 #include <iostream>
+#include <sstream>
+#include <cstdio>
+
+static Bson::object nodeToBson(const ConversationNode &msg)
+{
+    Bson::object msgObj = {
+        {"id", msg.id},
+        {"role", msg.role},
+        {"stopReason", msg.stopReason},
+        {"content", msg.content},
+        {"parentId", msg.parentId},
+        {"timestamp", std::to_string(msg.timestamp)},
+        {"pinned", msg.pinned}};
+    Bson::array childIds;
+    for (const auto &childId : msg.childIds)
+        childIds.push_back(childId);
+    msgObj["childIds"] = childIds;
+    return msgObj;
+}
+
+static Bson::array branchToBson(AI *ai)
+{
+    Bson::array branch;
+    for (const auto &step : ai->getBranch())
+        branch.push_back(Bson::object{
+            {"id", step.id},
+            {"siblingIndex", step.siblingIndex},
+            {"siblingCount", step.siblingCount}});
+    return branch;
+}
+static Bson switchResultToBson(AI *ai, bool switched)
+{
+    return Bson::object{
+        {"switched", switched},
+        {"currentNodeId", ai->getCurrentNodeId()},
+        {"branch", branchToBson(ai)}};
+}
+
+static Bson conversationToBson(const ConversationInfo &conv)
+{
+    return Bson::object{
+        {"id", conv.id},
+        {"title", conv.title},
+        {"createdAt", std::to_string(conv.createdAt)},
+        {"updatedAt", std::to_string(conv.updatedAt)},
+        {"messageCount", conv.messageCount},
+        {"lastSnippet", conv.lastSnippet}};
+}
 
 JSAI::JSAI() : AIObject(nullptr) {}
 
 JSAI::~JSAI() {}
 
-void JSAI::initialize(JQFunctionInfo &info)
+void JSAI::initialize(JQAsyncInfo &info)
 {
     try
     {
         ASSERT(info.Length() == 0);
         std::lock_guard<std::mutex> lock(aiObjectMutex);
-        AIObject = std::make_unique<AI>();
-        info.GetReturnValue().Set(true);
+        // Every AI page initializes on mount; the instance a running generation writes into must survive that
+        if (!AIObject)
+        {
+            AIObject = std::make_shared<AI>();
+            AIObject->saveConversation();
+        }
+        info.post(true);
     }
     catch (const std::exception &e)
     {
-        info.GetReturnValue().ThrowInternalError(e.what());
+        info.postError(e.what());
     }
 }
 void JSAI::getCurrentPath(JQFunctionInfo &info)
 {
     try
     {
-        AI *ai = getAIObject();
+        std::shared_ptr<AI> ai = getAIObject();
         ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
         std::vector<ConversationNode> path = ai->getCurrentPath();
         Bson::array result;
         for (const auto &msg : path)
+            result.push_back(nodeToBson(msg));
+        info.GetReturnValue().Set(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::getPathChanges(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 1);
+        JSContext *ctx = info.GetContext();
+        double sinceVersion = JQNumber(ctx, info[0]).getDouble();
+        ASSERT(sinceVersion >= 0);
+
+        PathChanges changes = ai->getPathChanges((uint64_t)sinceVersion);
+        Bson::object result = {
+            {"version", (double)changes.version},
+            {"reset", changes.reset}};
+        if (changes.pathChanged)
         {
-            Bson::object msgObj = {
-                {"id", msg.id},
-                {"role", msg.role},
-                {"stopReason", msg.stopReason},
-                {"content", msg.content},
-                {"parentId", msg.parentId},
-                {"timestamp", std::to_string(msg.timestamp)}};
-            Bson::array childIds;
-            for (const auto &childId : msg.childIds)
-                childIds.push_back(childId);
-            msgObj["childIds"] = childIds;
-            result.push_back(msgObj);
+            Bson::array path;
+            for (const auto &id : changes.path)
+                path.push_back(id);
+            result["path"] = path;
         }
+        Bson::array nodes;
+        for (const auto &node : changes.nodes)
+            nodes.push_back(nodeToBson(node));
+        result["nodes"] = nodes;
         info.GetReturnValue().Set(result);
     }
     catch (const std::exception &e)
@@ -71,7 +144,7 @@ void JSAI::getChildNodes(JQFunctionInfo &info)
 {
     try
     {
-        AI *ai = getAIObject();
+        std::shared_ptr<AI> ai = getAIObject();
         ASSERT(ai != nullptr);
         ASSERT(info.Length() == 1);
         JSContext *ctx = info.GetContext();
@@ -88,30 +161,122 @@ void JSAI::getChildNodes(JQFunctionInfo &info)
         info.GetReturnValue().ThrowInternalError(e.what());
     }
 }
-void JSAI::switchToNode(JQFunctionInfo &info)
+// Switching may read message content from the database, so these run off the JS thread
+void JSAI::switchToNode(JQAsyncInfo &info)
 {
     try
     {
-        AI *ai = getAIObject();
+        std::shared_ptr<AI> ai = getAIObject();
         ASSERT(ai != nullptr);
         ASSERT(info.Length() == 1);
+        ASSERT(info[0].is_string());
+        info.post(ai->switchNode(info[0].string_value()));
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSAI::switchToLeaf(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 1 || info.Length() == 2);
+        ASSERT(info[0].is_string());
+        bool lastChild = info.Length() == 2 && info[1].bool_value();
+
+        bool switched = ai->switchToLeaf(info[0].string_value(), lastChild);
+        info.post(switchResultToBson(ai.get(), switched));
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSAI::switchSibling(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 2);
+        ASSERT(info[0].is_string());
+        ASSERT(info[1].is_number());
+
+        bool switched = ai->switchSibling(info[0].string_value(), info[1].int_value());
+        info.post(switchResultToBson(ai.get(), switched));
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSAI::setPinned(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 2);
         JSContext *ctx = info.GetContext();
         std::string nodeId = JQString(ctx, info[0]).getString();
-
-        info.GetReturnValue().Set(ai->switchNode(nodeId));
+        bool pinned = JQBool(ctx, info[1]).getBool();
+        info.GetReturnValue().Set(ai->setPinned(nodeId, pinned));
     }
     catch (const std::exception &e)
     {
         info.GetReturnValue().ThrowInternalError(e.what());
     }
 }
+void JSAI::getBranch(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 0);
+        info.GetReturnValue().Set(branchToBson(ai.get()));
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::getSubtree(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 1 || info.Length() == 2);
+        ASSERT(info[0].is_string());
+        std::string nodeId = info[0].string_value();
+        int maxDepth = info.Length() == 2 && info[1].is_number() ? info[1].int_value() : -1;
+
+        Bson::array result;
+        for (const auto &entry : ai->getSubtree(nodeId, maxDepth))
+        {
+            Bson::object node = nodeToBson(entry.node);
+            node["depth"] = entry.depth;
+            result.push_back(node);
+        }
+        info.post(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
 void JSAI::getCurrentNodeId(JQFunctionInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
-        info.GetReturnValue().Set(AIObject->getCurrentNodeId());
+        info.GetReturnValue().Set(ai->getCurrentNodeId());
     }
     catch (const std::exception &e)
     {
@@ -122,9 +287,10 @@ void JSAI::getRootNodeId(JQFunctionInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
-        info.GetReturnValue().Set(AIObject->getRootNodeId());
+        info.GetReturnValue().Set(ai->getRootNodeId());
     }
     catch (const std::exception &e)
     {
@@ -136,7 +302,9 @@ void JSAI::getCurrentConversationId(JQFunctionInfo &info)
 {
     try
     {
-        info.GetReturnValue().Set(AIObject->getConversationId());
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        info.GetReturnValue().Set(ai->getConversationId());
     }
     catch (const std::exception &e)
     {
@@ -148,11 +316,12 @@ void JSAI::addUserMessage(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 1);
         ASSERT(info[0].is_string());
         std::string userMessage = info[0].string_value();
-        AIObject->addNode(ConversationNode::ROLE_USER, userMessage);
+        ai->addNode(ConversationNode::ROLE_USER, userMessage);
         info.post(true);
     }
     catch (const std::exception &e)
@@ -164,13 +333,33 @@ void JSAI::generateResponse(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
-        AIStreamCallback callback = [this](const std::string &messageDelta)
-        {
-            publish("ai_stream", messageDelta);
-        };
-        info.post(AIObject->generateResponse(callback));
+        auto publisher = std::make_shared<StreamPublisher>(jsHandler(),
+                                                           [this](const std::string &frame)
+                                                           { publish("ai_stream", frame); },
+                                                           streamFrameMs, streamFrameBytes, streamMaxPendingFrames);
+        // The promise settles from the I/O thread, so this module thread is free as soon as the request is queued
+        ai->generateResponse([publisher](const std::string &messageDelta)
+                                   { publisher->push(messageDelta); },
+                                   [publisher, info](const std::string &response, std::exception_ptr error)
+                                   {
+                                       publisher->flush();
+                                       if (!error)
+                                       {
+                                           info.post(response);
+                                           return;
+                                       }
+                                       try
+                                       {
+                                           std::rethrow_exception(error);
+                                       }
+                                       catch (const std::exception &e)
+                                       {
+                                           info.postError(e.what());
+                                       }
+                                   });
     }
     catch (const std::exception &e)
     {
@@ -181,7 +370,7 @@ void JSAI::stopGeneration(JQFunctionInfo &info)
 {
     try
     {
-        AI *ai = getAIObject();
+        std::shared_ptr<AI> ai = getAIObject();
         ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
         ai->stopGeneration();
@@ -192,14 +381,112 @@ void JSAI::stopGeneration(JQFunctionInfo &info)
         info.GetReturnValue().ThrowInternalError(e.what());
     }
 }
+void JSAI::setStreamCheckpoint(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 2);
+        JSContext *ctx = info.GetContext();
+        int intervalMs = JQNumber(ctx, info[0]).getInt32();
+        int bytes = JQNumber(ctx, info[1]).getInt32();
+        ASSERT(bytes >= 0);
+        ai->setStreamCheckpoint(intervalMs, bytes);
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::setStreamFrame(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 3);
+        JSContext *ctx = info.GetContext();
+        int frameMs = JQNumber(ctx, info[0]).getInt32();
+        int frameBytes = JQNumber(ctx, info[1]).getInt32();
+        int maxPendingFrames = JQNumber(ctx, info[2]).getInt32();
+        ASSERT(frameMs >= 0);
+        ASSERT(frameBytes >= 0);
+        ASSERT(maxPendingFrames >= 1);
+        streamFrameMs = frameMs;
+        streamFrameBytes = frameBytes;
+        streamMaxPendingFrames = maxPendingFrames;
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::getStreamStats(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 0);
+        ChatChunkStats stats = ai->getStreamStats();
+        info.GetReturnValue().Set(Bson::object{
+            {"chunks", (double)stats.chunks},
+            {"bytes", (double)stats.bytes},
+            {"parseMicros", stats.parseNanoseconds / 1000.0}});
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::setContextPolicy(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 2);
+        JSContext *ctx = info.GetContext();
+        int maxPromptTokens = JQNumber(ctx, info[0]).getInt32();
+        int keepTurns = JQNumber(ctx, info[1]).getInt32();
+        ai->setContextPolicy(maxPromptTokens, keepTurns);
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::getContextReport(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 0);
+        ContextReport report = ai->getContextReport();
+        info.GetReturnValue().Set(Bson::object{
+            {"totalMessages", (double)report.totalMessages},
+            {"sentMessages", (double)report.sentMessages},
+            {"totalTokens", (double)report.totalTokens},
+            {"sentTokens", (double)report.sentTokens},
+            {"requestBytes", (double)report.requestBytes}});
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
 void JSAI::getModels(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
         Bson::array modelsArray;
-        for (const auto &model : AIObject->getModels())
+        for (const auto &model : ai->getModels())
             modelsArray.push_back(model);
         info.post(modelsArray);
     }
@@ -212,9 +499,10 @@ void JSAI::getUserBalance(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
-        info.post(AIObject->getUserBalance());
+        info.post(ai->getUserBalance());
     }
     catch (const std::exception &e)
     {
@@ -226,19 +514,98 @@ void JSAI::getConversationList(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
         Bson::array conversationsArray;
-        auto response = AIObject->getConversationList();
+        auto response = ai->getConversationList();
         for (const auto &conv : response)
+            conversationsArray.push_back(conversationToBson(conv));
+        info.post(conversationsArray);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+
+void JSAI::getConversationPage(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 1 || info.Length() == 2);
+        ASSERT(info[0].is_number());
+        int limit = info[0].int_value();
+        ASSERT(limit > 0);
+
+        std::unique_ptr<ConversationInfo> after;
+        if (info.Length() == 2 && info[1].is_object())
         {
-            conversationsArray.push_back(Bson::object{
-                {"id", conv.id},
-                {"title", conv.title},
-                {"createdAt", std::to_string(conv.createdAt)},
-                {"updatedAt", std::to_string(conv.updatedAt)}});
+            const Bson &cursor = info[1];
+            ASSERT(cursor["id"].is_string());
+            long long updatedAt = cursor["updatedAt"].is_string() ? std::stoll(cursor["updatedAt"].string_value())
+                                                                  : (long long)cursor["updatedAt"].number_value();
+            after = std::make_unique<ConversationInfo>(cursor["id"].string_value(), "", 0, updatedAt);
         }
-        info.post(conversationsArray);
+
+        auto page = ai->getConversationPage(limit, after.get());
+        Bson::array items;
+        for (const auto &conv : page)
+            items.push_back(conversationToBson(conv));
+        Bson::object result = {{"items", items}};
+        if ((int)page.size() == limit)
+            result["nextCursor"] = Bson::object{
+                {"updatedAt", std::to_string(page.back().updatedAt)},
+                {"id", page.back().id}};
+        info.post(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+
+void JSAI::searchMessages(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() >= 1 && info.Length() <= 3);
+        ASSERT(info[0].is_string());
+        int limit = 20;
+        if (info.Length() >= 2 && info[1].is_number())
+            limit = info[1].int_value();
+        ASSERT(limit > 0);
+        // The cursor is "<rank> <seq>" from the previous page's nextCursor
+        std::unique_ptr<SearchCursor> after;
+        if (info.Length() == 3 && info[2].is_string())
+        {
+            after = std::make_unique<SearchCursor>();
+            std::istringstream cursor(info[2].string_value());
+            ASSERT(cursor >> after->rank >> after->seq);
+        }
+
+        SearchPage page = ai->searchMessages(info[0].string_value(), limit, after.get());
+        Bson::array items;
+        for (const auto &result : page.items)
+            items.push_back(Bson::object{
+                {"conversationId", result.conversationId},
+                {"conversationTitle", result.conversationTitle},
+                {"nodeId", result.nodeId},
+                {"role", (int)result.role},
+                {"snippet", result.snippet},
+                {"rank", result.rank}});
+        Bson::object response = {{"items", items}, {"partial", page.partial}};
+        if (page.hasMore)
+        {
+            char cursor[64];
+            snprintf(cursor, sizeof(cursor), "%.17g %lld", page.next.rank, (long long)page.next.seq);
+            response["nextCursor"] = std::string(cursor);
+        }
+        info.post(response);
     }
     catch (const std::exception &e)
     {
@@ -250,13 +617,14 @@ void JSAI::createConversation(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() <= 1);
         std::string title = "新对话";
         if (info.Length() == 1 && !info[0].string_value().empty())
             title = info[0].string_value();
         ASSERT(!title.empty());
-        AIObject->createConversation(title);
+        ai->createConversation(title);
         info.post(true);
     }
     catch (const std::exception &e)
@@ -269,11 +637,12 @@ void JSAI::loadConversation(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 1);
         ASSERT(info[0].is_string());
         std::string conversationId = info[0].string_value();
-        AIObject->loadConversation(conversationId);
+        ai->loadConversation(conversationId);
         info.post(true);
     }
     catch (const std::exception &e)
@@ -286,11 +655,12 @@ void JSAI::deleteConversation(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 1);
         ASSERT(info[0].is_string());
         std::string conversationId = info[0].string_value();
-        AIObject->deleteConversation(conversationId);
+        ai->deleteConversation(conversationId);
         info.post(true);
     }
     catch (const std::exception &e)
@@ -303,13 +673,14 @@ void JSAI::updateConversationTitle(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 2);
         ASSERT(info[0].is_string());
         ASSERT(info[1].is_string());
         std::string conversationId = info[0].string_value();
         std::string title = info[1].string_value();
-        AIObject->updateConversationTitle(conversationId, title);
+        ai->updateConversationTitle(conversationId, title);
         info.post(true);
     }
     catch (const std::exception &e)
@@ -318,36 +689,35 @@ void JSAI::updateConversationTitle(JQAsyncInfo &info)
     }
 }
 
-void JSAI::setSettings(JQFunctionInfo &info)
+void JSAI::setSettings(JQAsyncInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 7);
-        JSContext *ctx = info.GetContext();
-        std::string apiKey = JQString(ctx, info[0]).getString();
-        std::string baseUrl = JQString(ctx, info[1]).getString();
-        std::string modelName = JQString(ctx, info[2]).getString();
-        int maxTokens = JQNumber(ctx, info[3]).getInt32();
-        double temperature = JQNumber(ctx, info[4]).getDouble();
-        double topP = JQNumber(ctx, info[5]).getDouble();
-        std::string systemPrompt = JQString(ctx, info[6]).getString();
-
-        AIObject->setSettings(apiKey, baseUrl, modelName, maxTokens, temperature, topP, systemPrompt);
-        info.GetReturnValue().Set(true);
+        ASSERT(info[0].is_string() && info[1].is_string() && info[2].is_string());
+        ASSERT(info[3].is_number() && info[4].is_number() && info[5].is_number());
+        ASSERT(info[6].is_string());
+
+        ai->setSettings(info[0].string_value(), info[1].string_value(), info[2].string_value(),
+                        info[3].int_value(), info[4].number_value(), info[5].number_value(),
+                        info[6].string_value());
+        info.post(true);
     }
     catch (const std::exception &e)
     {
-        info.GetReturnValue().ThrowInternalError(e.what());
+        info.postError(e.what());
     }
 }
 void JSAI::getSettings(JQFunctionInfo &info)
 {
     try
     {
-        ASSERT(AIObject != nullptr);
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
         ASSERT(info.Length() == 0);
-        SettingsResponse settings = AIObject->getSettings();
+        SettingsResponse settings = ai->getSettings();
         info.GetReturnValue().Set(Bson::object{
             {"apiKey", settings.apiKey},
             {"baseUrl", settings.baseUrl},
@@ -362,6 +732,73 @@ void JSAI::getSettings(JQFunctionInfo &info)
         info.GetReturnValue().ThrowInternalError(e.what());
     }
 }
+void JSAI::setFallbackEndpoints(JQAsyncInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 1);
+        ASSERT(info[0].is_array());
+        std::vector<AIEndpoint> endpoints;
+        for (const auto &item : info[0].array_items())
+        {
+            ASSERT(item["baseUrl"].is_string());
+            ASSERT(item["apiKey"].is_string());
+            endpoints.push_back(AIEndpoint{item["baseUrl"].string_value(), item["apiKey"].string_value()});
+        }
+        ai->setFallbackEndpoints(endpoints);
+        info.post(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSAI::getFallbackEndpoints(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 0);
+        Bson::array result;
+        for (const auto &endpoint : ai->getFallbackEndpoints())
+            result.push_back(Bson::object{
+                {"baseUrl", endpoint.baseUrl},
+                {"apiKey", endpoint.apiKey}});
+        info.GetReturnValue().Set(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSAI::getEndpointHealth(JQFunctionInfo &info)
+{
+    try
+    {
+        std::shared_ptr<AI> ai = getAIObject();
+        ASSERT(ai != nullptr);
+        ASSERT(info.Length() == 0);
+        Bson::array result;
+        for (const auto &health : ai->getEndpointHealth())
+            result.push_back(Bson::object{
+                {"baseUrl", health.baseUrl},
+                {"requests", (double)health.requests},
+                {"failures", (double)health.failures},
+                {"latencyMs", health.latencyMs},
+                {"errorRate", health.errorRate},
+                {"measured", health.measured},
+                {"consecutiveFailures", health.consecutiveFailures},
+                {"cooldownMs", (double)health.cooldownMs}});
+        info.GetReturnValue().Set(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
 
 extern JSValue createAI(JQModuleEnv *env)
 {
@@ -369,10 +806,16 @@ extern JSValue createAI(JQModuleEnv *env)
     tpl->InstanceTemplate()->setObjectCreator([]()
                                               { return new JSAI(); });
 
-    tpl->SetProtoMethod("initialize", &JSAI::initialize);
+    tpl->SetProtoMethodPromise("initialize", &JSAI::initialize);
     tpl->SetProtoMethod("getCurrentPath", &JSAI::getCurrentPath);
+    tpl->SetProtoMethod("getPathChanges", &JSAI::getPathChanges);
     tpl->SetProtoMethod("getChildNodes", &JSAI::getChildNodes);
-    tpl->SetProtoMethod("switchToNode", &JSAI::switchToNode);
+    tpl->SetProtoMethodPromise("switchToNode", &JSAI::switchToNode);
+    tpl->SetProtoMethodPromise("switchToLeaf", &JSAI::switchToLeaf);
+    tpl->SetProtoMethodPromise("switchSibling", &JSAI::switchSibling);
+    tpl->SetProtoMethod("setPinned", &JSAI::setPinned);
+    tpl->SetProtoMethod("getBranch", &JSAI::getBranch);
+    tpl->SetProtoMethodPromise("getSubtree", &JSAI::getSubtree);
     tpl->SetProtoMethod("getCurrentNodeId", &JSAI::getCurrentNodeId);
     tpl->SetProtoMethod("getRootNodeId", &JSAI::getRootNodeId);
     tpl->SetProtoMethod("getCurrentConversationId", &JSAI::getCurrentConversationId);
@@ -380,17 +823,27 @@ extern JSValue createAI(JQModuleEnv *env)
     tpl->SetProtoMethodPromise("addUserMessage", &JSAI::addUserMessage);
     tpl->SetProtoMethodPromise("generateResponse", &JSAI::generateResponse);
     tpl->SetProtoMethod("stopGeneration", &JSAI::stopGeneration);
+    tpl->SetProtoMethod("setStreamCheckpoint", &JSAI::setStreamCheckpoint);
+    tpl->SetProtoMethod("setStreamFrame", &JSAI::setStreamFrame);
+    tpl->SetProtoMethod("getStreamStats", &JSAI::getStreamStats);
+    tpl->SetProtoMethod("setContextPolicy", &JSAI::setContextPolicy);
+    tpl->SetProtoMethod("getContextReport", &JSAI::getContextReport);
     tpl->SetProtoMethodPromise("getModels", &JSAI::getModels);
     tpl->SetProtoMethodPromise("getUserBalance", &JSAI::getUserBalance);
 
     tpl->SetProtoMethodPromise("getConversationList", &JSAI::getConversationList);
+    tpl->SetProtoMethodPromise("getConversationPage", &JSAI::getConversationPage);
+    tpl->SetProtoMethodPromise("searchMessages", &JSAI::searchMessages);
     tpl->SetProtoMethodPromise("createConversation", &JSAI::createConversation);
     tpl->SetProtoMethodPromise("loadConversation", &JSAI::loadConversation);
     tpl->SetProtoMethodPromise("deleteConversation", &JSAI::deleteConversation);
     tpl->SetProtoMethodPromise("updateConversationTitle", &JSAI::updateConversationTitle);
 
-    tpl->SetProtoMethod("setSettings", &JSAI::setSettings);
+    tpl->SetProtoMethodPromise("setSettings", &JSAI::setSettings);
     tpl->SetProtoMethod("getSettings", &JSAI::getSettings);
+    tpl->SetProtoMethodPromise("setFallbackEndpoints", &JSAI::setFallbackEndpoints);
+    tpl->SetProtoMethod("getFallbackEndpoints", &JSAI::getFallbackEndpoints);
+    tpl->SetProtoMethod("getEndpointHealth", &JSAI::getEndpointHealth);
 
     JSAI::InitTpl(tpl);
     return tpl->CallConstructor();
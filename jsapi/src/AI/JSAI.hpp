@@ -18,7 +18,9 @@
 #pragma once
 
 #include "AI.hpp"
+#include "StreamPublisher.hpp"
 #include <jqutil_v2/jqutil.h>
+#include <atomic>
 #include <memory>
 #include <mutex>
 
@@ -27,23 +29,31 @@ using namespace JQUTIL_NS;
 class JSAI : public JQPublishObject
 {
 private:
-    std::unique_ptr<AI> AIObject;
+    std::shared_ptr<AI> AIObject;
     mutable std::mutex aiObjectMutex;
 
-    AI *getAIObject() const
+    std::atomic<int> streamFrameMs{50}, streamFrameBytes{256}, streamMaxPendingFrames{2};
+
+    std::shared_ptr<AI> getAIObject() const
     {
         std::lock_guard<std::mutex> lock(aiObjectMutex);
-        return AIObject.get();
+        return AIObject;
     }
 
 public:
     JSAI();
     ~JSAI();
 
-    void initialize(JQFunctionInfo &info);
+    void initialize(JQAsyncInfo &info);
     void getCurrentPath(JQFunctionInfo &info);
+    void getPathChanges(JQFunctionInfo &info);
     void getChildNodes(JQFunctionInfo &info);
-    void switchToNode(JQFunctionInfo &info);
+    void switchToNode(JQAsyncInfo &info);
+    void switchToLeaf(JQAsyncInfo &info);
+    void switchSibling(JQAsyncInfo &info);
+    void setPinned(JQFunctionInfo &info);
+    void getBranch(JQFunctionInfo &info);
+    void getSubtree(JQAsyncInfo &info);
     void getCurrentNodeId(JQFunctionInfo &info);
     void getRootNodeId(JQFunctionInfo &info);
     void getCurrentConversationId(JQFunctionInfo &info);
@@ -51,17 +61,27 @@ public:
     void addUserMessage(JQAsyncInfo &info);
     void generateResponse(JQAsyncInfo &info);
     void stopGeneration(JQFunctionInfo &info);
+    void setStreamCheckpoint(JQFunctionInfo &info);
+    void setStreamFrame(JQFunctionInfo &info);
+    void getStreamStats(JQFunctionInfo &info);
+    void setContextPolicy(JQFunctionInfo &info);
+    void getContextReport(JQFunctionInfo &info);
     void getModels(JQAsyncInfo &info);
     void getUserBalance(JQAsyncInfo &info);
 
     void getConversationList(JQAsyncInfo &info);
+    void getConversationPage(JQAsyncInfo &info);
+    void searchMessages(JQAsyncInfo &info);
     void createConversation(JQAsyncInfo &info);
     void loadConversation(JQAsyncInfo &info);
     void deleteConversation(JQAsyncInfo &info);
     void updateConversationTitle(JQAsyncInfo &info);
 
-    void setSettings(JQFunctionInfo &info);
+    void setSettings(JQAsyncInfo &info);
     void getSettings(JQFunctionInfo &info);
+    void setFallbackEndpoints(JQAsyncInfo &info);
+    void getFallbackEndpoints(JQFunctionInfo &info);
+    void getEndpointHealth(JQFunctionInfo &info);
 };
 
 extern JSValue createAI(JQModuleEnv *env);
@@ -0,0 +1,34 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ConversationNode.hpp"
+
+struct PathChanges
+{
+    uint64_t version = 0;
+    // The conversation was replaced since the requested version; drop everything cached
+    bool reset = false;
+    // Set when the ids on the root-to-current path differ from the requested version
+    bool pathChanged = false;
+    std::vector<std::string> path;
+    std::vector<ConversationNode> nodes;
+};
@@ -0,0 +1,53 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ConversationNode.hpp"
+
+struct SearchResult
+{
+    std::string conversationId;
+    std::string conversationTitle;
+    std::string nodeId;
+    ConversationNode::ROLE role;
+    std::string snippet;
+    // bm25 score, lower is better; 0 when the LIKE fallback was used
+    double rank;
+    // Rowid of the message, the tie-breaker of the page cursor
+    int64_t seq;
+};
+
+// Where the next page of a search starts: after (rank, seq) in bm25 order, or
+// below seq for the LIKE fallback
+struct SearchCursor
+{
+    double rank = 0;
+    int64_t seq = 0;
+};
+
+struct SearchPage
+{
+    std::vector<SearchResult> items;
+    bool hasMore = false;
+    // The LIKE fallback stopped at its scan bound before filling the page
+    bool partial = false;
+    SearchCursor next;
+};
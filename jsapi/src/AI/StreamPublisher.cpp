@@ -0,0 +1,78 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "StreamPublisher.hpp"
+
+StreamPublisher::StreamPublisher(JQuick::sp<JQuick::Handler> handler, Deliver deliver,
+                                 int frameMs, size_t frameBytes, int maxPendingFrames)
+    : handler(handler), deliver(std::move(deliver)),
+      frameMs(frameMs), frameBytes(frameBytes), maxPendingFrames(maxPendingFrames),
+      state(std::make_shared<State>()) {}
+
+void StreamPublisher::push(const std::string &delta)
+{
+    if (delta.empty())
+        return;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->buffer += delta;
+    if (state->pendingFrames >= maxPendingFrames)
+    {
+        // A queued frame will pick this text up when the JS thread gets to it
+        state->skippedFrames++;
+        return;
+    }
+    if (state->buffer.size() >= frameBytes)
+    {
+        state->pendingFrames++;
+        handler->post(new FrameTask(state, deliver, false));
+    }
+    else if (!state->timerArmed)
+    {
+        state->timerArmed = true;
+        state->pendingFrames++;
+        handler->postDelayed(new FrameTask(state, deliver, true), frameMs);
+    }
+}
+
+void StreamPublisher::flush()
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->buffer.empty())
+        return;
+    state->pendingFrames++;
+    handler->post(new FrameTask(state, deliver, false));
+}
+
+int StreamPublisher::skippedFrames() const
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->skippedFrames;
+}
+
+void StreamPublisher::FrameTask::run()
+{
+    std::string frame;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->pendingFrames--;
+        if (timer)
+            state->timerArmed = false;
+        frame.swap(state->buffer);
+    }
+    if (!frame.empty())
+        deliver(frame);
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <jqutil_v2/jqutil.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Merges streamed deltas into frames delivered on the JS thread. A frame goes
+// out once frameMs have passed since the first buffered delta or frameBytes
+// have accumulated. While maxPendingFrames frames are still queued on the JS
+// thread, new deltas are only buffered, so a slow consumer gets fewer, larger
+// frames instead of a growing backlog.
+class StreamPublisher
+{
+public:
+    using Deliver = std::function<void(const std::string &frame)>;
+
+    StreamPublisher(JQuick::sp<JQuick::Handler> handler, Deliver deliver,
+                    int frameMs = 50, size_t frameBytes = 256, int maxPendingFrames = 2);
+
+    void push(const std::string &delta);
+    // Queues whatever is buffered, ignoring the thresholds; call when the stream ends
+    void flush();
+
+    int skippedFrames() const;
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::string buffer;
+        int pendingFrames = 0;
+        int skippedFrames = 0;
+        bool timerArmed = false;
+    };
+
+    class FrameTask : public JQuick::Task
+    {
+    private:
+        std::shared_ptr<State> state;
+        Deliver deliver;
+        bool timer;
+
+    public:
+        FrameTask(std::shared_ptr<State> state, Deliver deliver, bool timer)
+            : state(std::move(state)), deliver(std::move(deliver)), timer(timer) {}
+        void run() override;
+    };
+
+    JQuick::sp<JQuick::Handler> handler;
+    Deliver deliver;
+    int frameMs;
+    size_t frameBytes;
+    int maxPendingFrames;
+    std::shared_ptr<State> state;
+};
@@ -0,0 +1,75 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "TokenEstimator.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace
+{
+    struct ModelFamily
+    {
+        const char *name;
+        double asciiTokens, otherTokens;
+    };
+
+    // Matched as a substring of the lower-cased model name, first match wins
+    const ModelFamily modelFamilies[] = {
+        {"deepseek", 0.3, 0.6},
+        {"qwen", 0.25, 0.6},
+        {"glm", 0.25, 0.6},
+        {"moonshot", 0.25, 0.6},
+        {"kimi", 0.25, 0.6},
+        {"gpt-4o", 0.25, 0.7},
+        {"gpt", 0.25, 1.0},
+        {"claude", 0.3, 1.0},
+        {"gemini", 0.25, 0.7},
+    };
+    // Unknown models are costed pessimistically so the budget is not overrun
+    const ModelFamily defaultFamily = {"", 0.3, 1.0};
+}
+
+TokenEstimator::TokenEstimator(double asciiTokens, double otherTokens, int64_t messageOverhead)
+    : asciiTokens(asciiTokens), otherTokens(otherTokens), messageOverhead(messageOverhead) {}
+
+TokenEstimator TokenEstimator::forModel(const std::string &model)
+{
+    std::string name = model;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+    for (const auto &family : modelFamilies)
+        if (name.find(family.name) != std::string::npos)
+            return TokenEstimator(family.asciiTokens, family.otherTokens, 4);
+    return TokenEstimator(defaultFamily.asciiTokens, defaultFamily.otherTokens, 4);
+}
+
+int64_t TokenEstimator::estimate(std::string_view text) const
+{
+    size_t ascii = 0, other = 0;
+    for (unsigned char c : text)
+        if (c < 0x80)
+            ascii++;
+        else if ((c & 0xC0) != 0x80)
+            other++;
+    return (int64_t)std::ceil(ascii * asciiTokens + other * otherTokens);
+}
+
+int64_t TokenEstimator::estimateMessage(std::string_view content) const
+{
+    return estimate(content) + messageOverhead;
+}
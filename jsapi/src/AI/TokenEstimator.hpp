@@ -0,0 +1,39 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Approximates prompt tokens without a tokenizer. Rates are per character and come from
+// the vendors' published rules of thumb, with a fixed framing cost per chat message.
+class TokenEstimator
+{
+private:
+    double asciiTokens, otherTokens;
+    int64_t messageOverhead;
+
+public:
+    TokenEstimator(double asciiTokens, double otherTokens, int64_t messageOverhead);
+
+    static TokenEstimator forModel(const std::string &model);
+
+    int64_t estimate(std::string_view text) const;
+    int64_t estimateMessage(std::string_view content) const;
+};
@@ -0,0 +1,183 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "CurlPool.hpp"
+#include <Exceptions/CurlError.hpp>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    const size_t MAX_IDLE_PER_ORIGIN = 2;
+    const size_t MAX_IDLE = 8;
+
+    struct State
+    {
+        CURLSH *share = nullptr;
+        std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+        std::mutex mutex;
+        std::unordered_map<std::string, std::vector<CURL *>> idle;
+        size_t idleCount = 0;
+        ConnectionStats stats{};
+    };
+
+    void lockShare(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+    {
+        static_cast<State *>(userptr)->shareLocks[data].lock();
+    }
+
+    void unlockShare(CURL *, curl_lock_data data, void *userptr)
+    {
+        static_cast<State *>(userptr)->shareLocks[data].unlock();
+    }
+
+    State &state()
+    {
+        static State instance;
+        static std::once_flag initialized;
+        std::call_once(initialized, []()
+                       {
+                           curl_global_init(CURL_GLOBAL_DEFAULT);
+                           instance.share = curl_share_init();
+                           if (!instance.share)
+                               return;
+                           curl_share_setopt(instance.share, CURLSHOPT_LOCKFUNC, lockShare);
+                           curl_share_setopt(instance.share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+                           curl_share_setopt(instance.share, CURLSHOPT_USERDATA, &instance);
+                           curl_share_setopt(instance.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+                           // The connection cache is deliberately not shared: libcurl does not support
+                           // sharing it between threads using it concurrently. Connections are kept
+                           // alive by the pooled handles and the FetchEngine multi handle instead.
+                           curl_share_setopt(instance.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+                       });
+        return instance;
+    }
+
+    // scheme://host[:port], lower-cased
+    std::string originOf(const std::string &url)
+    {
+        size_t hostBegin = url.find("://");
+        hostBegin = hostBegin == std::string::npos ? 0 : hostBegin + 3;
+        size_t hostEnd = url.find_first_of("/?#", hostBegin);
+        std::string origin = url.substr(0, hostEnd);
+        for (char &c : origin)
+            c = std::tolower((unsigned char)c);
+        return origin;
+    }
+}
+
+CurlPool::Handle::Handle(CURL *curl, std::string origin) : curl(curl), origin(std::move(origin)) {}
+
+CurlPool::Handle::Handle(Handle &&other) noexcept : curl(other.curl), origin(std::move(other.origin))
+{
+    other.curl = nullptr;
+}
+
+CurlPool::Handle::~Handle()
+{
+    if (!curl)
+        return;
+    // Options are cleared, but the handle keeps its live connections and caches
+    curl_easy_reset(curl);
+    State &pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto &handles = pool.idle[origin];
+    if (handles.size() >= MAX_IDLE_PER_ORIGIN || pool.idleCount >= MAX_IDLE)
+    {
+        curl_easy_cleanup(curl);
+        return;
+    }
+    handles.push_back(curl);
+    pool.idleCount++;
+}
+
+CURL *CurlPool::Handle::get() const { return curl; }
+
+CurlPool::Handle CurlPool::acquire(const std::string &url)
+{
+    State &pool = state();
+    std::string origin = originOf(url);
+    CURL *curl = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        auto it = pool.idle.find(origin);
+        if (it != pool.idle.end() && !it->second.empty())
+        {
+            curl = it->second.back();
+            it->second.pop_back();
+            pool.idleCount--;
+        }
+    }
+    if (!curl)
+        curl = curl_easy_init();
+    if (!curl)
+        THROW_CURL_ERROR(CURLE_FAILED_INIT);
+    Handle handle(curl, origin);
+
+    if (pool.share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, pool.share);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    return handle;
+}
+
+void CurlPool::record(CURL *curl)
+{
+    long connects = 0;
+    curl_off_t connectTime = 0, appConnectTime = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connectTime);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnectTime);
+
+    State &pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    ConnectionStats &stats = pool.stats;
+    stats.requests++;
+    if (connects > 0)
+    {
+        stats.newConnections++;
+        stats.handshakeMs += std::max(connectTime, appConnectTime) / 1000.0;
+    }
+    else
+    {
+        stats.reusedConnections++;
+        if (stats.newConnections > 0)
+            stats.savedMs += stats.handshakeMs / stats.newConnections;
+    }
+}
+
+ConnectionStats CurlPool::stats()
+{
+    State &pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    ConnectionStats stats = pool.stats;
+    stats.idleHandles = pool.idleCount;
+    return stats;
+}
+
+void CurlPool::reset()
+{
+    State &pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.stats = ConnectionStats{};
+}
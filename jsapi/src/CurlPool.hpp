@@ -0,0 +1,64 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <curl/curl.h>
+
+struct ConnectionStats
+{
+    uint64_t requests;
+    uint64_t newConnections;
+    uint64_t reusedConnections;
+    // Time spent in DNS, TCP and TLS setup for requests that opened a connection
+    double handshakeMs;
+    // Average handshake cost credited to every request that reused a connection
+    double savedMs;
+    size_t idleHandles;
+};
+
+// Process-wide pool of easy handles, kept per origin so connections stay alive between
+// requests. Every handle is attached to one CURLSH that shares the DNS cache and TLS
+// sessions across threads.
+class CurlPool
+{
+public:
+    class Handle
+    {
+    private:
+        CURL *curl;
+        std::string origin;
+
+    public:
+        Handle(CURL *curl, std::string origin);
+        Handle(Handle &&other) noexcept;
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+        ~Handle();
+
+        CURL *get() const;
+    };
+
+    static Handle acquire(const std::string &url);
+    // Call after curl_easy_perform to account for connection reuse
+    static void record(CURL *curl);
+
+    static ConnectionStats stats();
+    static void reset();
+};
@@ -0,0 +1,81 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Backup.hpp"
+#include <cstdio>
+
+BACKUP::BACKUP(sqlite3 *conn, const std::string &path) : path(path), tempPath(path + ".tmp")
+{
+    ASSERT(conn != nullptr);
+    ASSERT(!path.empty());
+    std::remove(tempPath.c_str());
+    if (sqlite3_open_v2(tempPath.c_str(), &backupConn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) == SQLITE_OK)
+        backup = sqlite3_backup_init(backupConn, "main", conn, "main");
+    if (backup == nullptr)
+    {
+        DatabaseError error(__FILE__, __LINE__, backupConn);
+        abort();
+        throw error;
+    }
+}
+BACKUP::~BACKUP()
+{
+    if (!done)
+        abort();
+}
+
+void BACKUP::abort()
+{
+    if (backup)
+        sqlite3_backup_finish(backup);
+    backup = nullptr;
+    sqlite3_close(backupConn);
+    backupConn = nullptr;
+    std::remove(tempPath.c_str());
+}
+
+bool BACKUP::step(int pages)
+{
+    ASSERT(!done && backup != nullptr);
+    ASSERT(pages > 0);
+    int result = sqlite3_backup_step(backup, pages);
+    remainingPages = sqlite3_backup_remaining(backup);
+    totalPages = sqlite3_backup_pagecount(backup);
+    if (result == SQLITE_OK)
+    {
+        busySteps = 0;
+        return false;
+    }
+    if ((result == SQLITE_BUSY || result == SQLITE_LOCKED) && ++busySteps <= MAX_BUSY_STEPS)
+        return false;
+    if (result != SQLITE_DONE)
+    {
+        DatabaseError error(__FILE__, __LINE__, backupConn);
+        abort();
+        throw error;
+    }
+
+    sqlite3_backup_finish(backup);
+    backup = nullptr;
+    sqlite3_close(backupConn);
+    backupConn = nullptr;
+    ASSERT(std::rename(tempPath.c_str(), path.c_str()) == 0);
+    done = true;
+    return true;
+}
+int BACKUP::remaining() const { return done ? 0 : remainingPages; }
+int BACKUP::pageCount() const { return totalPages; }
@@ -0,0 +1,51 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "Includes.hpp"
+
+// Copies a live database to path a few pages at a time. The copy is
+// written beside the target and renamed once complete, so an interrupted
+// backup never replaces a good one. Every call, including destruction,
+// has to come from the thread that uses the source connection.
+class BACKUP
+{
+private:
+    sqlite3 *backupConn = nullptr;
+    sqlite3_backup *backup = nullptr;
+    std::string path, tempPath;
+    int busySteps = 0, remainingPages = 0, totalPages = 0;
+    bool done = false;
+
+    void abort();
+
+public:
+    // Pause the caller should leave between steps so queries on the source can interleave
+    static constexpr int STEP_DELAY = 10; // milliseconds
+    static constexpr int MAX_BUSY_STEPS = 500;
+
+    BACKUP(sqlite3 *conn, const std::string &path);
+    BACKUP(const BACKUP &) = delete;
+    BACKUP &operator=(const BACKUP &) = delete;
+    ~BACKUP();
+
+    // Copies up to pages pages; returns true once the copy is complete and in place
+    bool step(int pages);
+    int remaining() const;
+    int pageCount() const;
+};
@@ -16,21 +16,342 @@
 // along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Database.hpp"
+#include "Profiler.hpp"
+#include <iostream>
+#include <set>
+#include <algorithm>
+#include <sys/stat.h>
 
-DATABASE::DATABASE(const std::string &filePath)
+namespace
 {
-    if (sqlite3_open(filePath.c_str(), &conn) != SQLITE_OK && conn)
+    const int MAINTENANCE_INTERVAL = 5000;    // milliseconds, when there are no checkpoints to pace it
+    const int64_t MAINTENANCE_IDLE_DELAY = 10000; // milliseconds without foreground work before vacuuming
+
+    int64_t steadyMillis()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // PRAGMAs that only report on the schema or the file, whatever their argument
+    const std::set<std::string> QUERY_PRAGMAS = {
+        "table_info", "table_xinfo", "table_list", "index_list", "index_info", "index_xinfo",
+        "foreign_key_list", "foreign_key_check", "integrity_check", "quick_check"};
+    // PRAGMAs that may be read but not set
+    const std::set<std::string> READ_PRAGMAS = {
+        "user_version", "schema_version", "application_id", "page_count", "page_size", "freelist_count",
+        "data_version", "encoding", "journal_mode", "auto_vacuum", "foreign_keys"};
+
+    // Keeps SQL from outside inside its own database file and out of transaction control:
+    // no ATTACH / DETACH, no BEGIN / COMMIT / SAVEPOINT and no PRAGMA that changes anything
+    int untrustedAuthorizer(void *, int action, const char *first, const char *second, const char *, const char *)
+    {
+        switch (action)
+        {
+        case SQLITE_TRANSACTION:
+        case SQLITE_SAVEPOINT:
+        case SQLITE_ATTACH:
+        case SQLITE_DETACH:
+            return SQLITE_DENY;
+        case SQLITE_PRAGMA:
+        {
+            std::string name = first;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            return QUERY_PRAGMAS.count(name) || (second == nullptr && READ_PRAGMAS.count(name)) ? SQLITE_OK : SQLITE_DENY;
+        }
+        default:
+            return SQLITE_OK;
+        }
+    }
+
+    // The first keyword of sql in upper case, after any whitespace and comments
+    std::string firstKeyword(const std::string &sql)
+    {
+        size_t position = 0;
+        while (position < sql.size())
+        {
+            if (isspace((unsigned char)sql[position]))
+                ++position;
+            else if (sql.compare(position, 2, "--") == 0)
+                position = std::min(sql.find('\n', position), sql.size());
+            else if (sql.compare(position, 2, "/*") == 0)
+                position = std::min(sql.find("*/", position + 2), sql.size() - 2) + 2;
+            else
+                break;
+        }
+        std::string keyword;
+        for (; position < sql.size() && isalpha((unsigned char)sql[position]); ++position)
+            keyword += toupper((unsigned char)sql[position]);
+        return keyword;
+    }
+}
+
+DatabaseOptions DatabaseOptions::interactive()
+{
+    return DatabaseOptions(JOURNAL_WAL, SYNCHRONOUS_NORMAL, -1024, 2 * 1024 * 1024, 2000, TEMP_STORE_MEMORY, false, 5000,
+                           AUTO_VACUUM_INCREMENTAL, 64);
+}
+DatabaseOptions DatabaseOptions::bulkLoad()
+{
+    return DatabaseOptions(JOURNAL_DEFAULT, SYNCHRONOUS_OFF, -8192, -1, 5000, TEMP_STORE_MEMORY, false, 0);
+}
+DatabaseOptions DatabaseOptions::reader()
+{
+    return DatabaseOptions(JOURNAL_DEFAULT, SYNCHRONOUS_DEFAULT, 0, -1, 1000, TEMP_STORE_DEFAULT, true, 0);
+}
+DatabaseOptions DatabaseOptions::profile(const std::string &name)
+{
+    if (name == "interactive")
+        return interactive();
+    if (name == "bulk-load")
+        return bulkLoad();
+    if (name == "reader")
+        return reader();
+    ASSERT(name.empty() || name == "default");
+    return DatabaseOptions();
+}
+
+DATABASE::DATABASE(const std::string &filePath, const DatabaseOptions &options) : filePath(filePath), options(options)
+{
+    int flags = options.readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    if (sqlite3_open_v2(filePath.c_str(), &conn, flags | SQLITE_OPEN_FULLMUTEX, nullptr) != SQLITE_OK)
+    {
+        if (conn)
+            sqlite3_close(conn);
+        conn = nullptr;
+        return;
+    }
+    try
+    {
+        applyOptions();
+    }
+    catch (...)
+    {
         sqlite3_close(conn);
+        conn = nullptr;
+        throw;
+    }
+    DatabaseProfiler::attach(conn, filePath);
+    markActivity();
+    startMaintenance();
 }
 DATABASE::~DATABASE()
 {
+    stopMaintenance();
     if (conn)
+    {
+        DatabaseProfiler::detach(conn);
         sqlite3_close(conn);
+    }
+}
+
+void DATABASE::pragma(const std::string &statement)
+{
+    ASSERT_DATABASE_OK(sqlite3_exec(conn, ("PRAGMA " + statement).c_str(), nullptr, nullptr, nullptr));
+}
+int64_t DATABASE::pragmaValue(const std::string &name)
+{
+    sqlite3_stmt *stmt = nullptr;
+    ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, ("PRAGMA " + name).c_str(), -1, &stmt, nullptr));
+    int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    ASSERT_DATABASE_OK(sqlite3_finalize(stmt));
+    return value;
+}
+void DATABASE::applyOptions()
+{
+    static const char *journalModes[] = {"", "DELETE", "TRUNCATE", "MEMORY", "WAL", "OFF"};
+    static const char *synchronousLevels[] = {"", "OFF", "NORMAL", "FULL"};
+    static const char *tempStores[] = {"", "FILE", "MEMORY"};
+
+    if (options.busyTimeout > 0)
+        ASSERT_DATABASE_OK(sqlite3_busy_timeout(conn, options.busyTimeout));
+    if (!options.readOnly && options.autoVacuum != DatabaseOptions::AUTO_VACUUM_DEFAULT)
+    {
+        int autoVacuum = options.autoVacuum - 1;
+        if (pragmaValue("auto_vacuum") != autoVacuum)
+        {
+            pragma("auto_vacuum = " + std::to_string(autoVacuum));
+            // Only sticks on a database without tables; an existing one has to be
+            // rebuilt once, by convertAutoVacuum()
+            autoVacuumPending = pragmaValue("auto_vacuum") != autoVacuum;
+        }
+    }
+    if (options.readOnly)
+        pragma("query_only = ON");
+    else if (options.journalMode != DatabaseOptions::JOURNAL_DEFAULT)
+        pragma(std::string("journal_mode = ") + journalModes[options.journalMode]);
+    if (options.synchronous != DatabaseOptions::SYNCHRONOUS_DEFAULT)
+        pragma(std::string("synchronous = ") + synchronousLevels[options.synchronous]);
+    if (options.cacheSize != 0)
+        pragma("cache_size = " + std::to_string(options.cacheSize));
+    if (options.mmapSize >= 0)
+        pragma("mmap_size = " + std::to_string(options.mmapSize));
+    if (options.tempStore != DatabaseOptions::TEMP_STORE_DEFAULT)
+        pragma(std::string("temp_store = ") + tempStores[options.tempStore]);
 }
 
+int DATABASE::walHook(void *userdata, sqlite3 *, const char *, int frames)
+{
+    DATABASE *database = static_cast<DATABASE *>(userdata);
+    if (database->pendingWalFrames.exchange(frames) < 1000 && frames >= 1000)
+        database->maintenanceCondition.notify_one();
+    return SQLITE_OK;
+}
+void DATABASE::startMaintenance()
+{
+    bool checkpointing = options.journalMode == DatabaseOptions::JOURNAL_WAL && options.checkpointInterval > 0;
+    bool vacuuming = options.autoVacuum == DatabaseOptions::AUTO_VACUUM_INCREMENTAL && options.vacuumPages > 0;
+    if (options.readOnly || (!checkpointing && !vacuuming))
+        return;
+
+    // Opened here rather than on the thread, so that without it the connection
+    // keeps SQLite's own automatic checkpoints
+    sqlite3 *maintenanceConn = nullptr;
+    if (sqlite3_open_v2(filePath.c_str(), &maintenanceConn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Maintenance connection error: " << sqlite3_errmsg(maintenanceConn) << std::endl;
+        sqlite3_close(maintenanceConn);
+        return;
+    }
+    sqlite3_busy_timeout(maintenanceConn, options.busyTimeout);
+    // The pager only switches to WAL once it has read the header.
+    sqlite3_exec(maintenanceConn, "SELECT COUNT(*) FROM sqlite_master", nullptr, nullptr, nullptr);
+
+    // Replaces the automatic checkpoint that would otherwise run inside whichever
+    // commit crosses the threshold, so writers never pay for it.
+    if (checkpointing)
+        sqlite3_wal_hook(conn, walHook, this);
+    maintenanceThread = std::thread(
+        [this, checkpointing, vacuuming, maintenanceConn]()
+        {
+            int interval = checkpointing ? options.checkpointInterval : MAINTENANCE_INTERVAL;
+            std::string vacuumStatement = "PRAGMA incremental_vacuum(" + std::to_string(options.vacuumPages) + ")";
+            std::unique_lock<std::mutex> lock(maintenanceMutex);
+            while (!maintenanceStopping)
+            {
+                maintenanceCondition.wait_for(lock, std::chrono::milliseconds(interval));
+                if (maintenanceStopping)
+                    continue;
+                lock.unlock();
+                // A bounded step per pass, and only once foreground work has
+                // settled, so the write lock it takes is never in anyone's way
+                if (vacuuming && steadyMillis() - lastActivity >= MAINTENANCE_IDLE_DELAY)
+                {
+                    sqlite3_stmt *stmt = nullptr;
+                    int64_t freePages = 0;
+                    if (sqlite3_prepare_v2(maintenanceConn, "PRAGMA freelist_count", -1, &stmt, nullptr) == SQLITE_OK &&
+                        sqlite3_step(stmt) == SQLITE_ROW)
+                        freePages = sqlite3_column_int64(stmt, 0);
+                    sqlite3_finalize(stmt);
+                    if (freePages > 0 &&
+                        sqlite3_exec(maintenanceConn, vacuumStatement.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK &&
+                        checkpointing && pendingWalFrames == 0)
+                        pendingWalFrames = 1;
+                }
+                if (checkpointing && pendingWalFrames != 0)
+                {
+                    int logFrames = 0, checkpointedFrames = 0;
+                    if (sqlite3_wal_checkpoint_v2(maintenanceConn, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logFrames, &checkpointedFrames) == SQLITE_OK)
+                        pendingWalFrames = logFrames - checkpointedFrames;
+                }
+                lock.lock();
+            }
+            sqlite3_close(maintenanceConn);
+        });
+}
+void DATABASE::stopMaintenance()
+{
+    if (!maintenanceThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(maintenanceMutex);
+        maintenanceStopping = true;
+    }
+    maintenanceCondition.notify_one();
+    maintenanceThread.join();
+}
+void DATABASE::transaction(const std::function<void()> &work, bool readOnly)
+{
+    ASSERT(conn != nullptr);
+    ASSERT_DATABASE_OK(sqlite3_exec(conn, readOnly ? "BEGIN DEFERRED" : "BEGIN IMMEDIATE", nullptr, nullptr, nullptr));
+    try
+    {
+        work();
+    }
+    catch (...)
+    {
+        sqlite3_exec(conn, "ROLLBACK", nullptr, nullptr, nullptr);
+        throw;
+    }
+    ASSERT_DATABASE_OK(sqlite3_exec(conn, "COMMIT", nullptr, nullptr, nullptr));
+}
+void DATABASE::checkpoint()
+{
+    ASSERT(conn != nullptr);
+    ASSERT_DATABASE_OK(sqlite3_wal_checkpoint_v2(conn, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr));
+}
+void DATABASE::incrementalVacuum(int pages)
+{
+    ASSERT(conn != nullptr);
+    ASSERT(pages >= 0);
+    pragma("incremental_vacuum(" + std::to_string(pages) + ")");
+}
+void DATABASE::convertAutoVacuum()
+{
+    if (!autoVacuumPending)
+        return;
+    autoVacuumPending = false;
+    ASSERT_DATABASE_OK(sqlite3_exec(conn, "VACUUM", nullptr, nullptr, nullptr));
+}
+void DATABASE::markActivity()
+{
+    lastActivity = steadyMillis();
+}
+DatabaseStats DATABASE::stats()
+{
+    ASSERT(conn != nullptr);
+    DatabaseStats stats;
+    stats.filePath = filePath;
+    stats.pageSize = pragmaValue("page_size");
+    stats.pageCount = pragmaValue("page_count");
+    stats.freelistCount = pragmaValue("freelist_count");
+    stats.autoVacuum = pragmaValue("auto_vacuum");
+    struct stat walStat;
+    stats.walSize = stat((filePath + "-wal").c_str(), &walStat) == 0 ? walStat.st_size : 0;
+    return stats;
+}
+std::unique_ptr<BACKUP> DATABASE::backup(const std::string &path)
+{
+    ASSERT(path != filePath);
+    if (conn == nullptr)
+        THROW_ASSERT_FAILED("cannot back up " + filePath + ": the database could not be opened");
+    return std::make_unique<BACKUP>(conn, path);
+}
 TABLE DATABASE::table(const std::string &tableName) { return TABLE(conn, tableName); }
 SELECT DATABASE::select(const std::string &tableName) { return SELECT(conn, tableName); }
 INSERT DATABASE::insert(const std::string &tableName) { return INSERT(conn, tableName); }
 DELETE DATABASE::remove(const std::string &tableName) { return DELETE(conn, tableName); }
 UPDATE DATABASE::update(const std::string &tableName) { return UPDATE(conn, tableName); }
 SIZE DATABASE::size(const std::string &tableName) { return SIZE(conn, tableName); }
+std::unique_ptr<STATEMENT> DATABASE::prepare(const std::string &sql) { return std::make_unique<STATEMENT>(conn, sql); }
+std::unique_ptr<STATEMENT> DATABASE::prepareUntrusted(const std::string &sql)
+{
+    ASSERT(conn != nullptr);
+    // VACUUM never reaches the authorizer, and VACUUM INTO writes to any path
+    if (firstKeyword(sql) == "VACUUM")
+        THROW_ASSERT_FAILED("VACUUM is not allowed here");
+    // Installed for this one prepare; the connection is only ever used by one thread at a time
+    sqlite3_set_authorizer(conn, untrustedAuthorizer, nullptr);
+    try
+    {
+        std::unique_ptr<STATEMENT> statement = std::make_unique<STATEMENT>(conn, sql);
+        sqlite3_set_authorizer(conn, nullptr, nullptr);
+        return statement;
+    }
+    catch (...)
+    {
+        sqlite3_set_authorizer(conn, nullptr, nullptr);
+        throw;
+    }
+}
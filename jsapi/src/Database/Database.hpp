@@ -22,21 +22,133 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
 #include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include "Table.hpp"
 #include "Select.hpp"
 #include "Insert.hpp"
 #include "Delete.hpp"
 #include "Update.hpp"
 #include "Size.hpp"
+#include "Statement.hpp"
+#include "Backup.hpp"
+
+class DatabaseOptions
+{
+public:
+    enum JournalMode
+    {
+        JOURNAL_DEFAULT,
+        JOURNAL_DELETE,
+        JOURNAL_TRUNCATE,
+        JOURNAL_MEMORY,
+        JOURNAL_WAL,
+        JOURNAL_OFF
+    };
+    enum Synchronous
+    {
+        SYNCHRONOUS_DEFAULT,
+        SYNCHRONOUS_OFF,
+        SYNCHRONOUS_NORMAL,
+        SYNCHRONOUS_FULL
+    };
+    enum TempStore
+    {
+        TEMP_STORE_DEFAULT,
+        TEMP_STORE_FILE,
+        TEMP_STORE_MEMORY
+    };
+    enum AutoVacuum
+    {
+        AUTO_VACUUM_DEFAULT,
+        AUTO_VACUUM_NONE,
+        AUTO_VACUUM_FULL,
+        AUTO_VACUUM_INCREMENTAL
+    };
+
+    JournalMode journalMode;
+    Synchronous synchronous;
+    int cacheSize;          // PRAGMA cache_size, negative values are KiB, 0 keeps the default
+    int64_t mmapSize;       // PRAGMA mmap_size in bytes, -1 keeps the default
+    int busyTimeout;        // milliseconds
+    TempStore tempStore;
+    bool readOnly;
+    int checkpointInterval; // milliseconds between background WAL checkpoints, 0 disables
+    AutoVacuum autoVacuum;  // changing it on an existing database costs one full VACUUM
+    int vacuumPages;        // free pages released per idle maintenance pass when INCREMENTAL, 0 disables
+
+    DatabaseOptions(JournalMode journalMode = JOURNAL_DEFAULT,
+                    Synchronous synchronous = SYNCHRONOUS_DEFAULT,
+                    int cacheSize = 0,
+                    int64_t mmapSize = -1,
+                    int busyTimeout = 0,
+                    TempStore tempStore = TEMP_STORE_DEFAULT,
+                    bool readOnly = false,
+                    int checkpointInterval = 0,
+                    AutoVacuum autoVacuum = AUTO_VACUUM_DEFAULT,
+                    int vacuumPages = 0)
+        : journalMode(journalMode), synchronous(synchronous), cacheSize(cacheSize),
+          mmapSize(mmapSize), busyTimeout(busyTimeout), tempStore(tempStore),
+          readOnly(readOnly), checkpointInterval(checkpointInterval),
+          autoVacuum(autoVacuum), vacuumPages(vacuumPages) {}
+
+    // WAL with NORMAL sync, checkpoints and incremental vacuum moved to a
+    // background thread, for databases written while the UI is waiting (AI
+    // history, IME learning).
+    static DatabaseOptions interactive();
+    // No fsync and a large page cache, for one-off imports that can be redone.
+    static DatabaseOptions bulkLoad();
+    // Read-only access to databases owned by other processes.
+    static DatabaseOptions reader();
+    // Looks up one of the profiles above by name: "interactive", "bulk-load" or "reader".
+    static DatabaseOptions profile(const std::string &name);
+};
+
+struct DatabaseStats
+{
+    std::string filePath;
+    int64_t pageSize;
+    int64_t pageCount;
+    int64_t freelistCount;
+    int64_t walSize; // bytes in the -wal file, 0 outside WAL mode
+    int autoVacuum;  // 0 none, 1 full, 2 incremental
+    // Share of the file that is free pages, which only a vacuum gives back
+    double fragmentation() const { return pageCount ? (double)freelistCount / pageCount : 0; }
+    int64_t fileSize() const { return pageSize * pageCount; }
+};
+
+using BackupProgress = std::function<void(int remaining, int total)>;
 
 class DATABASE
 {
 private:
-    sqlite3 *conn;
+    sqlite3 *conn = nullptr;
+    std::string filePath;
+    DatabaseOptions options;
+
+    std::thread maintenanceThread;
+    std::mutex maintenanceMutex;
+    std::condition_variable maintenanceCondition;
+    bool maintenanceStopping = false;
+    std::atomic<int> pendingWalFrames{0};
+    std::atomic<int64_t> lastActivity{0};
+    bool autoVacuumPending = false;
+
+    void pragma(const std::string &statement);
+    int64_t pragmaValue(const std::string &name);
+    void applyOptions();
+    void startMaintenance();
+    void stopMaintenance();
+    static int walHook(void *userdata, sqlite3 *conn, const char *dbName, int frames);
 
 public:
-    DATABASE(const std::string &filePath);
+    DATABASE(const std::string &filePath, const DatabaseOptions &options = DatabaseOptions());
+    DATABASE(const DATABASE &) = delete;
+    DATABASE &operator=(const DATABASE &) = delete;
     ~DATABASE();
 
     TABLE table(const std::string &tableName);
@@ -45,4 +157,21 @@ public:
     DELETE remove(const std::string &tableName);
     UPDATE update(const std::string &tableName);
     SIZE size(const std::string &tableName);
+    std::unique_ptr<STATEMENT> prepare(const std::string &sql);
+    // Like prepare(), but for SQL from outside: refuses transaction control, ATTACH,
+    // DETACH, VACUUM and any PRAGMA beyond a few read-only ones
+    std::unique_ptr<STATEMENT> prepareUntrusted(const std::string &sql);
+
+    void transaction(const std::function<void()> &work, bool readOnly = false);
+    void checkpoint();
+    // Releases up to pages free pages (all of them when pages is 0); needs auto_vacuum=INCREMENTAL.
+    void incrementalVacuum(int pages = 0);
+    // Rebuilds the file once when the auto_vacuum option could not be applied to
+    // an existing database by the pragma alone; slow, so kept out of the constructor
+    void convertAutoVacuum();
+    // Postpones idle maintenance; called for every piece of foreground work.
+    void markActivity();
+    DatabaseStats stats();
+    // Starts an incremental copy of the live database to path; see BACKUP
+    std::unique_ptr<BACKUP> backup(const std::string &path);
 };
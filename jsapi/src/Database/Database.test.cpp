@@ -0,0 +1,85 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+// SQL that JS hands to prepareUntrusted must stay inside its own database
+// file and leave transactions and settings alone.
+
+#include "Database.hpp"
+#include <iostream>
+#include <vector>
+
+int main()
+{
+    DATABASE database(":memory:");
+    database.prepare("CREATE TABLE t (a INTEGER)")->step();
+
+    const std::vector<std::string> refused = {
+        "ATTACH DATABASE '/userdisk/database/langningchen-ai.db' AS ai",
+        "attach ':memory:' as other",
+        "DETACH DATABASE main",
+        "BEGIN",
+        "SAVEPOINT s",
+        "VACUUM",
+        "  /* comment */ vacuum INTO '/tmp/copy.db'",
+        "PRAGMA journal_mode = DELETE",
+        "PRAGMA user_version = 3",
+        "PRAGMA writable_schema = ON",
+        "PRAGMA wal_checkpoint",
+    };
+    const std::vector<std::string> allowed = {
+        "SELECT * FROM t",
+        "INSERT INTO t (a) VALUES (1)",
+        "CREATE TABLE u (b TEXT)",
+        "PRAGMA table_info(t)",
+        "PRAGMA user_version",
+        "SELECT * FROM pragma_table_info('t')",
+    };
+
+    int failures = 0;
+    for (const auto &sql : refused)
+        try
+        {
+            database.prepareUntrusted(sql);
+            std::cerr << "FAIL: accepted " << sql << std::endl;
+            ++failures;
+        }
+        catch (const std::exception &)
+        {
+        }
+    for (const auto &sql : allowed)
+        try
+        {
+            database.prepareUntrusted(sql);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "FAIL: refused " << sql << ": " << e.what() << std::endl;
+            ++failures;
+        }
+
+    // The authorizer is only in place for the untrusted prepare
+    try
+    {
+        database.prepare("PRAGMA user_version = 3")->step();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "FAIL: trusted PRAGMA refused: " << e.what() << std::endl;
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "DatabaseExecutor.hpp"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+    std::mutex registryMutex;
+    std::unordered_multimap<std::string, DatabaseExecutor *> registry;
+}
+
+DatabaseExecutor::DatabaseExecutor(const std::string &filePath, const DatabaseOptions &options)
+    : filePath(filePath), readOnly(options.readOnly), database(filePath, options)
+{
+    // The first job, so the one-time rebuild happens on the worker thread ahead of any other work
+    post([](DATABASE &database)
+         { database.convertAutoVacuum(); });
+    worker = std::thread(&DatabaseExecutor::run, this);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.insert({filePath, this});
+}
+DatabaseExecutor::~DatabaseExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto range = registry.equal_range(filePath);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == this)
+            {
+                registry.erase(it);
+                break;
+            }
+    }
+    // Waits for withOpenExecutor() callers that found us before we left the registry
+    std::unique_lock<std::shared_mutex> inUse(useMutex);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_one();
+    worker.join();
+}
+
+void DatabaseExecutor::enqueue(std::function<void(DATABASE &)> work, bool readOnly)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        ASSERT(!stopping);
+        queue.push_back({std::move(work), readOnly});
+    }
+    queueCondition.notify_one();
+}
+void DatabaseExecutor::post(std::function<void(DATABASE &)> work, std::function<void(const std::exception &)> onError)
+{
+    enqueue([work, onError](DATABASE &database)
+            {
+                try
+                {
+                    work(database);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Database job error: " << e.what() << std::endl;
+                    if (onError)
+                        onError(e);
+                } },
+            false);
+}
+
+void DatabaseExecutor::run()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true)
+    {
+        queueCondition.wait(lock, [this]()
+                            { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        std::vector<Job> batch;
+        batch.push_back(std::move(queue.front()));
+        queue.pop_front();
+        if (batch.front().readOnly)
+            while (!queue.empty() && queue.front().readOnly)
+            {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        lock.unlock();
+
+        database.markActivity();
+        if (batch.size() == 1)
+            batch.front().work(database);
+        else
+            try
+            {
+                database.transaction([&batch, this]()
+                                     {
+                                         for (auto &job : batch)
+                                             job.work(database);
+                                     },
+                                     true);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Database read batch error: " << e.what() << std::endl;
+            }
+
+        lock.lock();
+    }
+}
+
+void DatabaseExecutor::backupTo(const std::string &path, int pagesPerStep, const BackupProgress &progress)
+{
+    ASSERT(pagesPerStep > 0);
+    std::shared_ptr<BACKUP> backup = submit([path](DATABASE &database)
+                                            { return std::shared_ptr<BACKUP>(database.backup(path)); })
+                                         .get();
+    // Finishing the backup touches the source connection, so it is released on the database thread
+    auto release = [this, &backup]()
+    {
+        submit([backup = std::move(backup)](DATABASE &) mutable
+               { backup.reset(); })
+            .get();
+    };
+    try
+    {
+        while (!submit([backup, pagesPerStep](DATABASE &)
+                       { return backup->step(pagesPerStep); })
+                    .get())
+        {
+            if (progress)
+                progress(backup->remaining(), backup->pageCount());
+            std::this_thread::sleep_for(std::chrono::milliseconds(BACKUP::STEP_DELAY));
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    if (progress)
+        progress(0, backup->pageCount());
+    release();
+}
+
+std::vector<std::string> DatabaseExecutor::openDatabases()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<std::string> filePaths;
+    for (const auto &pair : registry)
+        if (std::find(filePaths.begin(), filePaths.end(), pair.first) == filePaths.end())
+            filePaths.push_back(pair.first);
+    return filePaths;
+}
+bool DatabaseExecutor::withOpenExecutor(const std::string &filePath, const std::function<void(DatabaseExecutor &)> &work)
+{
+    std::unique_lock<std::mutex> registryLock(registryMutex);
+    auto range = registry.equal_range(filePath);
+    DatabaseExecutor *executor = nullptr;
+    for (auto it = range.first; it != range.second; ++it)
+        if (executor == nullptr || !it->second->readOnly)
+            executor = it->second;
+    if (executor == nullptr)
+        return false;
+    std::shared_lock<std::shared_mutex> inUse(executor->useMutex);
+    registryLock.unlock();
+    work(*executor);
+    return true;
+}
@@ -0,0 +1,124 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "Database.hpp"
+#include <jqutil_v2/jqutil.h>
+#include <deque>
+#include <future>
+#include <memory>
+#include <shared_mutex>
+#include <type_traits>
+
+// Owns one connection and runs every piece of work for it, in submission
+// order, on a single worker thread. Callers on the JS thread post writes and
+// return immediately; callers that need a result wait on a future or get a
+// completion posted to their own Handler.
+class DatabaseExecutor
+{
+private:
+    class CompletionTask : public JQuick::Task
+    {
+    private:
+        std::function<void()> completion;
+
+    public:
+        CompletionTask(std::function<void()> completion) : completion(std::move(completion)) {}
+        void run() override { completion(); }
+    };
+
+    struct Job
+    {
+        std::function<void(DATABASE &)> work;
+        bool readOnly;
+    };
+
+    std::string filePath;
+    bool readOnly;
+    // Held shared by withOpenExecutor() callers, which the destructor waits for
+    std::shared_mutex useMutex;
+    DATABASE database;
+    std::thread worker;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<Job> queue;
+    bool stopping = false;
+
+    void enqueue(std::function<void(DATABASE &)> work, bool readOnly);
+    void run();
+
+    template <typename F>
+    auto schedule(F work, bool readOnly) -> std::future<std::invoke_result_t<F, DATABASE &>>
+    {
+        using Result = std::invoke_result_t<F, DATABASE &>;
+        auto task = std::make_shared<std::packaged_task<Result(DATABASE &)>>(std::move(work));
+        std::future<Result> future = task->get_future();
+        enqueue([task](DATABASE &database)
+                { (*task)(database); },
+                readOnly);
+        return future;
+    }
+
+public:
+    DatabaseExecutor(const std::string &filePath, const DatabaseOptions &options = DatabaseOptions());
+    DatabaseExecutor(const DatabaseExecutor &) = delete;
+    DatabaseExecutor &operator=(const DatabaseExecutor &) = delete;
+    ~DatabaseExecutor();
+
+    template <typename F>
+    auto submit(F work) -> std::future<std::invoke_result_t<F, DATABASE &>>
+    {
+        return schedule(std::move(work), false);
+    }
+    // Consecutive read-only jobs are run together inside one read transaction.
+    template <typename F>
+    auto read(F work) -> std::future<std::invoke_result_t<F, DATABASE &>>
+    {
+        return schedule(std::move(work), true);
+    }
+    // Fire and forget; errors are logged, then handed to onError on the
+    // database thread so the caller can retry the work later.
+    void post(std::function<void(DATABASE &)> work, std::function<void(const std::exception &)> onError = nullptr);
+    // Runs work on the database thread, then hands the settled future to
+    // completion on handler's thread.
+    template <typename F, typename C>
+    void post(F work, JQuick::sp<JQuick::Handler> handler, C completion)
+    {
+        using Result = std::invoke_result_t<F, DATABASE &>;
+        auto task = std::make_shared<std::packaged_task<Result(DATABASE &)>>(std::move(work));
+        enqueue([task, handler, completion](DATABASE &database)
+                {
+                    (*task)(database);
+                    auto future = std::make_shared<std::future<Result>>(task->get_future());
+                    handler->post(new CompletionTask([future, completion]()
+                                                     { completion(*future); }));
+                },
+                false);
+    }
+
+    // Copies the database to path (see BACKUP) one step per job, so work
+    // queued for this executor runs between steps. Blocks until done; call
+    // it from a background thread.
+    void backupTo(const std::string &path, int pagesPerStep = 64, const BackupProgress &progress = nullptr);
+
+    // Runs work with an executor open on filePath, preferring a writable
+    // one, if there is one. The executor is kept alive until work returns.
+    static bool withOpenExecutor(const std::string &filePath, const std::function<void(DatabaseExecutor &)> &work);
+    static std::vector<std::string> openDatabases();
+};
@@ -22,28 +22,15 @@ DELETE::DELETE(sqlite3 *conn, std::string tableName) : conn(conn), tableName(tab
     ASSERT(conn != nullptr);
     ASSERT(!tableName.empty());
 }
-DELETE &DELETE::where(std::string column, std::string value)
-{
-    ASSERT(!column.empty());
-    ASSERT(!value.empty());
-    this->conditions.push_back({column, value});
-    return *this;
-}
 void DELETE::execute() const
 {
     std::string query = "DELETE FROM \"" + tableName + "\"";
-    if (!conditions.empty())
-    {
-        query += " WHERE ";
-        for (auto &condition : conditions)
-            query += "\"" + condition.first + "\"=? AND ";
-        query.erase(query.end() - 5, query.end());
-    }
+    if (!empty())
+        query += " WHERE " + toString();
     sqlite3_stmt *stmt = nullptr;
     ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, query.c_str(), -1, &stmt, nullptr));
     int idx = 1;
-    for (auto &condition : conditions)
-        ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, idx++, condition.second.c_str(), -1, SQLITE_TRANSIENT));
+    bind(conn, stmt, idx);
     ASSERT_DATABASE_OK(sqlite3_step(stmt));
     ASSERT_DATABASE_OK(sqlite3_finalize(stmt));
 }
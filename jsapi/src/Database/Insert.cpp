@@ -29,6 +29,32 @@ INSERT &INSERT::value(std::string column, std::string data)
     this->values.push_back(data);
     return *this;
 }
+INSERT &INSERT::onConflict(std::vector<std::string> columns)
+{
+    ASSERT(!columns.empty());
+    this->conflictColumns = columns;
+    return *this;
+}
+INSERT &INSERT::doUpdate(std::string column)
+{
+    return doUpdate(column, "excluded.\"" + column + "\"");
+}
+INSERT &INSERT::doUpdate(std::string column, std::string expression)
+{
+    ASSERT(!conflictColumns.empty());
+    ASSERT(conflictAction != CONFLICT_NOTHING);
+    ASSERT(!column.empty());
+    ASSERT(!expression.empty());
+    this->conflictAction = CONFLICT_UPDATE;
+    this->conflictUpdates.push_back({column, expression});
+    return *this;
+}
+INSERT &INSERT::doNothing()
+{
+    ASSERT(conflictAction != CONFLICT_UPDATE);
+    this->conflictAction = CONFLICT_NOTHING;
+    return *this;
+}
 int64_t INSERT::execute() const
 {
     std::string query = "INSERT INTO \"" + tableName + "\" (";
@@ -40,6 +66,23 @@ int64_t INSERT::execute() const
         query += "?, ";
     query.erase(query.end() - 2, query.end());
     query += ")";
+    if (conflictAction != CONFLICT_ABORT)
+    {
+        query += " ON CONFLICT (";
+        for (auto &column : conflictColumns)
+            query += "\"" + column + "\", ";
+        query.erase(query.end() - 2, query.end());
+        query += ")";
+        if (conflictAction == CONFLICT_NOTHING)
+            query += " DO NOTHING";
+        else
+        {
+            query += " DO UPDATE SET ";
+            for (auto &update : conflictUpdates)
+                query += "\"" + update.first + "\"=" + update.second + ", ";
+            query.erase(query.end() - 2, query.end());
+        }
+    }
     sqlite3_stmt *stmt = nullptr;
     ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, query.c_str(), -1, &stmt, nullptr));
     int idx = 1;
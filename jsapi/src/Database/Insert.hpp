@@ -27,6 +27,14 @@ private:
     std::string tableName;
     std::vector<std::string> columns;
     std::vector<std::string> values;
+    enum ConflictAction
+    {
+        CONFLICT_ABORT,
+        CONFLICT_NOTHING,
+        CONFLICT_UPDATE
+    } conflictAction = CONFLICT_ABORT;
+    std::vector<std::string> conflictColumns;
+    std::vector<std::pair<std::string, std::string>> conflictUpdates;
 
 public:
     INSERT(sqlite3 *conn, std::string tableName);
@@ -36,5 +44,9 @@ public:
     {
         return value(column, std::to_string(data));
     }
+    [[nodiscard]] INSERT &onConflict(std::vector<std::string> columns);
+    [[nodiscard]] INSERT &doUpdate(std::string column);
+    [[nodiscard]] INSERT &doUpdate(std::string column, std::string expression);
+    [[nodiscard]] INSERT &doNothing();
     int64_t execute() const;
 };
@@ -0,0 +1,406 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "JSDatabase.hpp"
+#include <cmath>
+#include <regex>
+
+namespace
+{
+    void bindParameters(STATEMENT &statement, const Bson &parameters)
+    {
+        statement.reset();
+        if (parameters.is_null())
+        {
+            ASSERT(statement.parameterCount() == 0);
+            return;
+        }
+        ASSERT(parameters.is_array());
+        const Bson::array &values = parameters.array_items();
+        ASSERT((int)values.size() == statement.parameterCount());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            const Bson &value = values[i];
+            int index = i + 1;
+            if (value.is_null())
+                statement.bindNull(index);
+            else if (value.is_bool())
+                statement.bind(index, (int64_t)value.bool_value());
+            else if (value.is_number())
+            {
+                // JS only has doubles; whole numbers go in as INTEGER so they
+                // compare and sort like the integers they stand for
+                double number = value.number_value();
+                if (std::trunc(number) == number && std::fabs(number) < 9007199254740992.0)
+                    statement.bind(index, (int64_t)number);
+                else
+                    statement.bind(index, number);
+            }
+            else if (value.is_string())
+                statement.bind(index, value.string_value());
+            else
+                THROW_ASSERT_FAILED("parameter " + std::to_string(index) + " must be null, boolean, number or string");
+        }
+    }
+    Bson readRow(const STATEMENT &statement)
+    {
+        Bson::object row;
+        for (int i = 0; i < statement.columnCount(); ++i)
+            switch (statement.columnType(i))
+            {
+            case SQLITE_INTEGER:
+                row[statement.columnName(i)] = (double)statement.columnInt(i);
+                break;
+            case SQLITE_FLOAT:
+                row[statement.columnName(i)] = statement.columnDouble(i);
+                break;
+            case SQLITE_TEXT:
+                row[statement.columnName(i)] = statement.columnText(i);
+                break;
+            case SQLITE_BLOB:
+            {
+                std::string blob = statement.columnBlob(i);
+                row[statement.columnName(i)] = Bson::binary(blob.begin(), blob.end());
+                break;
+            }
+            default:
+                row[statement.columnName(i)] = Bson();
+            }
+        return row;
+    }
+    Bson runStatement(STATEMENT &statement, const Bson &parameters)
+    {
+        bindParameters(statement, parameters);
+        while (statement.step())
+            ;
+        return Bson::object{
+            {"changes", statement.changes()},
+            {"lastInsertId", (double)statement.lastInsertId()}};
+    }
+    Bson allRows(STATEMENT &statement, const Bson &parameters)
+    {
+        bindParameters(statement, parameters);
+        Bson::array rows;
+        while (statement.step())
+            rows.push_back(readRow(statement));
+        statement.reset();
+        return rows;
+    }
+    // Steps up to limit rows; fewer than limit means the statement is exhausted and reset
+    Bson nextRows(STATEMENT &statement, size_t limit)
+    {
+        Bson::array rows;
+        while (rows.size() < limit)
+        {
+            if (!statement.step())
+            {
+                statement.reset();
+                break;
+            }
+            rows.push_back(readRow(statement));
+        }
+        bool done = rows.size() < limit;
+        return Bson::object{{"rows", rows}, {"done", done}};
+    }
+}
+
+JSDatabase::JSDatabase() {}
+JSDatabase::~JSDatabase()
+{
+    // Statements have to be finalized before their connections close
+    statements.clear();
+    databases.clear();
+}
+
+std::shared_ptr<DatabaseExecutor> JSDatabase::getDatabase(int handle)
+{
+    std::lock_guard<std::mutex> lock(handlesMutex);
+    auto it = databases.find(handle);
+    ASSERT(it != databases.end());
+    return it->second;
+}
+JSDatabase::PreparedStatement JSDatabase::getStatement(int handle)
+{
+    std::lock_guard<std::mutex> lock(handlesMutex);
+    auto it = statements.find(handle);
+    ASSERT(it != statements.end());
+    return it->second;
+}
+
+void JSDatabase::open(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 1 && info.Length() <= 2);
+        ASSERT(info[0].is_string());
+        std::string name = info[0].string_value();
+        ASSERT(std::regex_match(name, std::regex("[A-Za-z0-9_-]{1,64}")));
+        DatabaseOptions options = DatabaseOptions::interactive();
+        if (info.Length() == 2)
+        {
+            ASSERT(info[1].is_string());
+            options = DatabaseOptions::profile(info[1].string_value());
+        }
+
+        auto executor = std::make_shared<DatabaseExecutor>("/userdisk/database/app-" + name + ".db", options);
+        std::lock_guard<std::mutex> lock(handlesMutex);
+        int handle = nextHandle++;
+        databases[handle] = executor;
+        info.post(handle);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::close(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 1);
+        int handle = info[0].int_value();
+        std::shared_ptr<DatabaseExecutor> executor;
+        {
+            std::lock_guard<std::mutex> lock(handlesMutex);
+            auto it = databases.find(handle);
+            ASSERT(it != databases.end());
+            executor = it->second;
+            databases.erase(it);
+            for (auto statement = statements.begin(); statement != statements.end();)
+                if (statement->second.database == handle)
+                    statement = statements.erase(statement);
+                else
+                    ++statement;
+        }
+        // Drains the queue and closes the connection here, off the JS thread
+        executor.reset();
+        info.post(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::exec(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 2 && info.Length() <= 3);
+        ASSERT(info[1].is_string());
+        auto executor = getDatabase(info[0].int_value());
+        std::string sql = info[1].string_value();
+        Bson parameters = info.Length() == 3 ? info[2] : Bson();
+        info.post(executor->submit([sql, parameters](DATABASE &database)
+                                   { return runStatement(*database.prepareUntrusted(sql), parameters); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::query(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 2 && info.Length() <= 3);
+        ASSERT(info[1].is_string());
+        auto executor = getDatabase(info[0].int_value());
+        std::string sql = info[1].string_value();
+        Bson parameters = info.Length() == 3 ? info[2] : Bson();
+        info.post(executor->read([sql, parameters](DATABASE &database)
+                                 { return allRows(*database.prepareUntrusted(sql), parameters); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::transaction(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 2);
+        ASSERT(info[1].is_array());
+        auto executor = getDatabase(info[0].int_value());
+        Bson::array steps = info[1].array_items();
+        for (const auto &step : steps)
+            ASSERT(step.is_array() && !step.array_items().empty() && step.array_items()[0].is_string());
+        info.post(executor->submit([steps](DATABASE &database)
+                                   {
+                                       Bson::array results;
+                                       database.transaction([&]()
+                                                            {
+                                                                for (const auto &step : steps)
+                                                                {
+                                                                    const Bson::array &items = step.array_items();
+                                                                    Bson parameters = items.size() > 1 ? items[1] : Bson();
+                                                                    results.push_back(runStatement(*database.prepareUntrusted(items[0].string_value()), parameters));
+                                                                } });
+                                       return Bson(results); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+
+void JSDatabase::prepare(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 2);
+        ASSERT(info[1].is_string());
+        int databaseHandle = info[0].int_value();
+        auto executor = getDatabase(databaseHandle);
+        std::string sql = info[1].string_value();
+        std::shared_ptr<STATEMENT> statement = executor->submit([sql](DATABASE &database)
+                                                                { return std::shared_ptr<STATEMENT>(database.prepareUntrusted(sql)); })
+                                                   .get();
+        std::lock_guard<std::mutex> lock(handlesMutex);
+        int handle = nextHandle++;
+        statements[handle] = {databaseHandle, executor, statement};
+        info.post(handle);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::run(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 1 && info.Length() <= 2);
+        PreparedStatement prepared = getStatement(info[0].int_value());
+        Bson parameters = info.Length() == 2 ? info[1] : Bson();
+        auto statement = prepared.statement;
+        info.post(prepared.executor->submit([statement, parameters](DATABASE &)
+                                            { return runStatement(*statement, parameters); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::all(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 1 && info.Length() <= 2);
+        PreparedStatement prepared = getStatement(info[0].int_value());
+        Bson parameters = info.Length() == 2 ? info[1] : Bson();
+        auto statement = prepared.statement;
+        info.post(prepared.executor->read([statement, parameters](DATABASE &)
+                                          { return allRows(*statement, parameters); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::iterate(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 1 && info.Length() <= 2);
+        PreparedStatement prepared = getStatement(info[0].int_value());
+        ASSERT(prepared.statement->readOnly());
+        Bson parameters = info.Length() == 2 ? info[1] : Bson();
+        auto statement = prepared.statement;
+        // Rows come back in batches as JS asks for them, so a large result
+        // never exists as a whole array on either side
+        info.post(prepared.executor->submit([statement, parameters](DATABASE &)
+                                            {
+                                                bindParameters(*statement, parameters);
+                                                return nextRows(*statement, ITERATE_BATCH_SIZE); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::next(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 1);
+        PreparedStatement prepared;
+        {
+            std::lock_guard<std::mutex> lock(handlesMutex);
+            auto it = statements.find(info[0].int_value());
+            if (it == statements.end()) // finalized mid-iteration
+            {
+                info.post(Bson::object{{"rows", Bson::array()}, {"done", true}});
+                return;
+            }
+            prepared = it->second;
+        }
+        auto statement = prepared.statement;
+        info.post(prepared.executor->submit([statement](DATABASE &)
+                                            { return nextRows(*statement, ITERATE_BATCH_SIZE); })
+                      .get());
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDatabase::finalize(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 1);
+        int handle = JQNumber(info.GetContext(), info[0]).getInt32();
+        std::lock_guard<std::mutex> lock(handlesMutex);
+        ASSERT(statements.erase(handle) == 1);
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+
+JSValue createDatabase(JQModuleEnv *env)
+{
+    JQFunctionTemplateRef tpl = JQFunctionTemplate::New(env, "Database");
+    tpl->InstanceTemplate()->setObjectCreator([]()
+                                              { return new JSDatabase(); });
+
+    tpl->SetProtoMethod("finalize", &JSDatabase::finalize);
+
+    tpl->SetProtoMethodPromise("open", &JSDatabase::open);
+    tpl->SetProtoMethodPromise("close", &JSDatabase::close);
+    tpl->SetProtoMethodPromise("exec", &JSDatabase::exec);
+    tpl->SetProtoMethodPromise("query", &JSDatabase::query);
+    tpl->SetProtoMethodPromise("transaction", &JSDatabase::transaction);
+    tpl->SetProtoMethodPromise("prepare", &JSDatabase::prepare);
+    tpl->SetProtoMethodPromise("run", &JSDatabase::run);
+    tpl->SetProtoMethodPromise("all", &JSDatabase::all);
+    tpl->SetProtoMethodPromise("iterate", &JSDatabase::iterate);
+    tpl->SetProtoMethodPromise("next", &JSDatabase::next);
+
+    JSDatabase::InitTpl(tpl);
+    return tpl->CallConstructor();
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <jqutil_v2/jqutil.h>
+#include "DatabaseExecutor.hpp"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace JQUTIL_NS;
+
+// Databases opened from JS live under /userdisk/database as app-<name>.db,
+// each behind its own DatabaseExecutor. Handles are plain numbers.
+class JSDatabase : public JQPublishObject
+{
+private:
+    struct PreparedStatement
+    {
+        int database;
+        std::shared_ptr<DatabaseExecutor> executor;
+        std::shared_ptr<STATEMENT> statement;
+    };
+
+    // Rows returned by each iterate() / next() call
+    static constexpr size_t ITERATE_BATCH_SIZE = 64;
+
+    std::mutex handlesMutex;
+    int nextHandle = 1;
+    std::unordered_map<int, std::shared_ptr<DatabaseExecutor>> databases;
+    std::unordered_map<int, PreparedStatement> statements;
+
+    std::shared_ptr<DatabaseExecutor> getDatabase(int handle);
+    PreparedStatement getStatement(int handle);
+
+public:
+    JSDatabase();
+    ~JSDatabase();
+
+    void open(JQAsyncInfo &info);
+    void close(JQAsyncInfo &info);
+    void exec(JQAsyncInfo &info);
+    void query(JQAsyncInfo &info);
+    void transaction(JQAsyncInfo &info);
+
+    void prepare(JQAsyncInfo &info);
+    void run(JQAsyncInfo &info);
+    void all(JQAsyncInfo &info);
+    void iterate(JQAsyncInfo &info);
+    void next(JQAsyncInfo &info);
+    void finalize(JQFunctionInfo &info);
+};
+
+extern JSValue createDatabase(JQModuleEnv *env);
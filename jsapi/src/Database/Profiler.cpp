@@ -0,0 +1,250 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Profiler.hpp"
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    struct Run
+    {
+        std::chrono::steady_clock::time_point start;
+        uint64_t rows = 0;
+    };
+
+    struct Connection
+    {
+        std::string filePath;
+        std::unordered_map<sqlite3_stmt *, Run> running;
+    };
+
+    struct State
+    {
+        std::mutex installMutex;
+        std::mutex mutex;
+        std::map<sqlite3 *, Connection> connections;
+        std::map<std::pair<std::string, std::string>, QueryStat> stats;
+        std::deque<SlowQuery> slowQueries;
+        bool enabled = false;
+        double slowThresholdMs = 100;
+        std::string slowLogPath;
+    };
+
+    const size_t MAX_SLOW_QUERIES = 50;
+    // Past this the log is moved to <path>.1, so at most twice this stays on disk
+    const std::streamoff MAX_SLOW_LOG_BYTES = 256 * 1024;
+
+    State &state()
+    {
+        static State instance;
+        return instance;
+    }
+
+    // "IN (?, ?, ?)" and "IN (?)" should count as the same statement
+    std::string normalize(const char *sql)
+    {
+        std::string result;
+        for (const char *c = sql; *c; ++c)
+        {
+            if (*c == '?' && result.size() >= 3 && result.compare(result.size() - 3, 3, "?, ") == 0)
+            {
+                result.erase(result.size() - 3);
+                result += "?...";
+                while (c[1] == ',' && c[2] == ' ' && c[3] == '?')
+                    c += 3;
+                continue;
+            }
+            result += *c;
+        }
+        return result;
+    }
+}
+
+void DatabaseProfiler::install(sqlite3 *conn, void *context, bool enabled)
+{
+    sqlite3_trace_v2(conn, enabled ? SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE : 0, enabled ? trace : nullptr, context);
+}
+
+// sqlite3_trace_v2 takes the connection mutex, and trace() runs while that
+// mutex is held and then takes State::mutex. Installing therefore happens
+// under installMutex only, never under State::mutex.
+void DatabaseProfiler::attach(sqlite3 *conn, const std::string &filePath)
+{
+    State &s = state();
+    std::lock_guard<std::mutex> installLock(s.installMutex);
+    Connection *connection;
+    bool enabled;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        connection = &s.connections[conn];
+        connection->filePath = filePath;
+        enabled = s.enabled;
+    }
+    if (enabled)
+        install(conn, connection, true);
+}
+void DatabaseProfiler::detach(sqlite3 *conn)
+{
+    State &s = state();
+    std::lock_guard<std::mutex> installLock(s.installMutex);
+    install(conn, nullptr, false);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.connections.erase(conn);
+}
+
+void DatabaseProfiler::enable(double slowThresholdMs, const std::string &slowLogPath)
+{
+    State &s = state();
+    std::lock_guard<std::mutex> installLock(s.installMutex);
+    std::vector<std::pair<sqlite3 *, Connection *>> connections;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.slowThresholdMs = slowThresholdMs;
+        s.slowLogPath = slowLogPath;
+        if (s.enabled)
+            return;
+        s.enabled = true;
+        for (auto &pair : s.connections)
+            connections.push_back({pair.first, &pair.second});
+    }
+    for (auto &pair : connections)
+        install(pair.first, pair.second, true);
+}
+void DatabaseProfiler::disable()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> installLock(s.installMutex);
+    std::vector<sqlite3 *> connections;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.enabled)
+            return;
+        s.enabled = false;
+        for (auto &pair : s.connections)
+        {
+            connections.push_back(pair.first);
+            pair.second.running.clear();
+        }
+    }
+    for (auto conn : connections)
+        install(conn, nullptr, false);
+}
+bool DatabaseProfiler::enabled()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.enabled;
+}
+void DatabaseProfiler::reset()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stats.clear();
+    s.slowQueries.clear();
+}
+
+int DatabaseProfiler::trace(unsigned type, void *context, void *p, void *x)
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.enabled)
+        return 0;
+    Connection &connection = *static_cast<Connection *>(context);
+    sqlite3_stmt *stmt = static_cast<sqlite3_stmt *>(p);
+
+    // SQLite's own PROFILE time comes from the VFS clock, which only has
+    // millisecond resolution, so runs are timed here from STMT to PROFILE
+    if (type == SQLITE_TRACE_STMT)
+    {
+        if (!connection.running.count(stmt)) // trigger sub-statements report again
+            connection.running[stmt].start = std::chrono::steady_clock::now();
+        return 0;
+    }
+    if (type == SQLITE_TRACE_ROW)
+    {
+        auto run = connection.running.find(stmt);
+        if (run != connection.running.end())
+            run->second.rows++;
+        return 0;
+    }
+
+    double ms = *static_cast<sqlite3_int64 *>(x) / 1e6;
+    uint64_t rows = 0;
+    auto run = connection.running.find(stmt);
+    if (run != connection.running.end())
+    {
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - run->second.start).count();
+        rows = run->second.rows;
+        connection.running.erase(run);
+    }
+    std::string sql = normalize(sqlite3_sql(stmt));
+
+    QueryStat &stat = s.stats[{connection.filePath, sql}];
+    if (stat.count == 0)
+        stat.database = connection.filePath, stat.sql = sql;
+    stat.count++;
+    stat.rows += rows;
+    stat.totalMs += ms;
+    stat.maxMs = std::max(stat.maxMs, ms);
+
+    if (ms >= s.slowThresholdMs)
+    {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+        s.slowQueries.push_back({connection.filePath, sql, ms, now});
+        if (s.slowQueries.size() > MAX_SLOW_QUERIES)
+            s.slowQueries.pop_front();
+        // Only the placeholder form is logged; bound values may hold API keys or user text
+        if (!s.slowLogPath.empty())
+        {
+            if (std::ifstream(s.slowLogPath, std::ios::ate).tellg() >= MAX_SLOW_LOG_BYTES)
+                std::rename(s.slowLogPath.c_str(), (s.slowLogPath + ".1").c_str());
+            std::ofstream(s.slowLogPath, std::ios::app)
+                << now << '\t' << ms << "ms\t" << connection.filePath << '\t' << sql << '\n';
+        }
+    }
+    return 0;
+}
+
+std::vector<QueryStat> DatabaseProfiler::snapshot()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::vector<QueryStat> result;
+    result.reserve(s.stats.size());
+    for (const auto &pair : s.stats)
+        result.push_back(pair.second);
+    std::sort(result.begin(), result.end(),
+              [](const QueryStat &a, const QueryStat &b)
+              { return a.totalMs > b.totalMs; });
+    return result;
+}
+std::vector<SlowQuery> DatabaseProfiler::slowQueries()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return std::vector<SlowQuery>(s.slowQueries.begin(), s.slowQueries.end());
+}
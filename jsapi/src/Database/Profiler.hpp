@@ -0,0 +1,64 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <sqlite3/sqlite3.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct QueryStat
+{
+    std::string database;
+    std::string sql;
+    uint64_t count;
+    uint64_t rows;
+    double totalMs;
+    double maxMs;
+};
+
+struct SlowQuery
+{
+    std::string database;
+    std::string sql;
+    double ms;
+    int64_t timestamp;
+};
+
+// Opt-in statement profiling for every open DATABASE, keyed by the SQL text
+// with placeholders, so different bound values count as one statement.
+// Nothing is traced until enable() is called.
+class DatabaseProfiler
+{
+private:
+    static int trace(unsigned type, void *context, void *p, void *x);
+    static void install(sqlite3 *conn, void *context, bool enabled);
+
+public:
+    static void attach(sqlite3 *conn, const std::string &filePath);
+    static void detach(sqlite3 *conn);
+
+    static void enable(double slowThresholdMs = 100, const std::string &slowLogPath = "/userdisk/database/slow-query.log");
+    static void disable();
+    static bool enabled();
+    static void reset();
+
+    static std::vector<QueryStat> snapshot();
+    static std::vector<SlowQuery> slowQueries();
+};
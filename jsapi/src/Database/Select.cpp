@@ -29,13 +29,6 @@ SELECT &SELECT::select(std::string column)
     this->columns.push_back(column);
     return *this;
 }
-SELECT &SELECT::where(std::string column, std::string value)
-{
-    ASSERT(!column.empty());
-    ASSERT(!value.empty());
-    this->conditions.push_back({column, value});
-    return *this;
-}
 SELECT &SELECT::order(std::string column, bool ascending)
 {
     ASSERT(!column.empty());
@@ -65,13 +58,8 @@ std::vector<std::unordered_map<std::string, std::string>> SELECT::execute() cons
         query.erase(query.end() - 2, query.end());
     }
     query += " FROM \"" + tableName + "\"";
-    if (!conditions.empty())
-    {
-        query += " WHERE ";
-        for (auto &condition : conditions)
-            query += "\"" + condition.first + "\"=? AND ";
-        query.erase(query.end() - 5, query.end());
-    }
+    if (!empty())
+        query += " WHERE " + toString();
     if (!orders.empty())
     {
         query += " ORDER BY ";
@@ -87,8 +75,7 @@ std::vector<std::unordered_map<std::string, std::string>> SELECT::execute() cons
     sqlite3_stmt *stmt = nullptr;
     ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, query.c_str(), -1, &stmt, nullptr));
     int idx = 1;
-    for (auto &condition : conditions)
-        ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, idx++, condition.second.c_str(), -1, SQLITE_TRANSIENT));
+    bind(conn, stmt, idx);
     std::vector<std::unordered_map<std::string, std::string>> Data;
     int colCount = columns.empty() ? sqlite3_column_count(stmt) : columns.size();
     while (sqlite3_step(stmt) == SQLITE_ROW)
@@ -18,17 +18,17 @@
 #pragma once
 
 #include "Includes.hpp"
+#include "Where.hpp"
 #include <vector>
 #include <functional>
 #include <unordered_map>
 
-class SELECT
+class SELECT : public WHERE<SELECT>
 {
 private:
     sqlite3 *conn;
     std::string tableName;
     std::vector<std::string> columns;
-    std::vector<std::pair<std::string, std::string>> conditions;
     std::vector<std::pair<std::string, bool>> orders;
     size_t limits = 0;
     size_t offsets = 0;
@@ -36,12 +36,6 @@ private:
 public:
     SELECT(sqlite3 *conn, std::string tableName);
     [[nodiscard]] SELECT &select(std::string column);
-    [[nodiscard]] SELECT &where(std::string column, std::string value);
-    template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
-    [[nodiscard]] SELECT &where(std::string column, T data)
-    {
-        return where(column, std::to_string(data));
-    }
     [[nodiscard]] SELECT &order(std::string column, bool ascending);
     [[nodiscard]] SELECT &limit(size_t limits);
     [[nodiscard]] SELECT &offset(size_t offsets);
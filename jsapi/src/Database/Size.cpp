@@ -28,8 +28,7 @@ int SIZE::execute() const
     std::string query = "SELECT COUNT(*) FROM \"" + tableName + "\"";
     sqlite3_stmt *stmt = nullptr;
     ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, query.c_str(), -1, &stmt, nullptr));
-    ASSERT_DATABASE_OK(sqlite3_step(stmt));
-    int count = sqlite3_column_int(stmt, 0);
-    ASSERT_DATABASE_OK(sqlite3_finalize(stmt));
+    int count = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    ASSERT_DATABASE_OK(sqlite3_finalize(stmt)); // reports the step's error, if any
     return count;
 }
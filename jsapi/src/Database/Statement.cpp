@@ -0,0 +1,121 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Statement.hpp"
+#include <cctype>
+
+STATEMENT::STATEMENT(sqlite3 *conn, const std::string &sql) : conn(conn)
+{
+    ASSERT(conn != nullptr);
+    ASSERT(!sql.empty());
+    const char *tail = nullptr;
+    ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, sql.c_str(), -1, &stmt, &tail));
+    ASSERT(stmt != nullptr);
+    for (; *tail; ++tail)
+        if (!isspace(*tail) && *tail != ';')
+        {
+            sqlite3_finalize(stmt);
+            THROW_ASSERT_FAILED("only one SQL statement can be prepared at a time");
+        }
+}
+STATEMENT::~STATEMENT()
+{
+    sqlite3_finalize(stmt);
+}
+
+STATEMENT &STATEMENT::bindNull(int index)
+{
+    ASSERT_DATABASE_OK(sqlite3_bind_null(stmt, index));
+    return *this;
+}
+STATEMENT &STATEMENT::bind(int index, int64_t value)
+{
+    ASSERT_DATABASE_OK(sqlite3_bind_int64(stmt, index, value));
+    return *this;
+}
+STATEMENT &STATEMENT::bind(int index, double value)
+{
+    ASSERT_DATABASE_OK(sqlite3_bind_double(stmt, index, value));
+    return *this;
+}
+STATEMENT &STATEMENT::bind(int index, const std::string &value)
+{
+    ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, index, value.c_str(), value.size(), SQLITE_TRANSIENT));
+    return *this;
+}
+int STATEMENT::parameterCount() const
+{
+    return sqlite3_bind_parameter_count(stmt);
+}
+void STATEMENT::reset()
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+bool STATEMENT::step()
+{
+    int result = sqlite3_step(stmt);
+    if (result == SQLITE_ROW)
+        return true;
+    ASSERT_DATABASE_OK(result);
+    return false;
+}
+int STATEMENT::columnCount() const
+{
+    return sqlite3_column_count(stmt);
+}
+std::string STATEMENT::columnName(int column) const
+{
+    return sqlite3_column_name(stmt, column);
+}
+int STATEMENT::columnType(int column) const
+{
+    return sqlite3_column_type(stmt, column);
+}
+int64_t STATEMENT::columnInt(int column) const
+{
+    return sqlite3_column_int64(stmt, column);
+}
+double STATEMENT::columnDouble(int column) const
+{
+    return sqlite3_column_double(stmt, column);
+}
+std::string STATEMENT::columnText(int column) const
+{
+    const unsigned char *value = sqlite3_column_text(stmt, column);
+    return value ? std::string(reinterpret_cast<const char *>(value), sqlite3_column_bytes(stmt, column)) : "";
+}
+std::string STATEMENT::columnBlob(int column) const
+{
+    const void *value = sqlite3_column_blob(stmt, column);
+    return value ? std::string(static_cast<const char *>(value), sqlite3_column_bytes(stmt, column)) : "";
+}
+
+int STATEMENT::changes() const
+{
+    return sqlite3_changes(conn);
+}
+int64_t STATEMENT::lastInsertId() const
+{
+    return sqlite3_last_insert_rowid(conn);
+}
+bool STATEMENT::readOnly() const
+{
+    return sqlite3_stmt_readonly(stmt);
+}
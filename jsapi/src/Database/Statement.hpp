@@ -0,0 +1,59 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "Includes.hpp"
+#include <cstdint>
+
+// A prepared statement with typed binds, for SQL the builders cannot
+// express. Parameters are 1-based as in sqlite3_bind_*.
+class STATEMENT
+{
+private:
+    sqlite3 *conn;
+    sqlite3_stmt *stmt = nullptr;
+
+public:
+    STATEMENT(sqlite3 *conn, const std::string &sql);
+    STATEMENT(const STATEMENT &) = delete;
+    STATEMENT &operator=(const STATEMENT &) = delete;
+    ~STATEMENT();
+
+    STATEMENT &bindNull(int index);
+    STATEMENT &bind(int index, int64_t value);
+    STATEMENT &bind(int index, double value);
+    STATEMENT &bind(int index, const std::string &value);
+    int parameterCount() const;
+    // Rewinds to the first row and drops all bound values
+    void reset();
+
+    // Returns true while a row is available
+    bool step();
+    int columnCount() const;
+    std::string columnName(int column) const;
+    int columnType(int column) const;
+    int64_t columnInt(int column) const;
+    double columnDouble(int column) const;
+    std::string columnText(int column) const;
+    std::string columnBlob(int column) const;
+
+    int changes() const;
+    int64_t lastInsertId() const;
+    bool readOnly() const;
+};
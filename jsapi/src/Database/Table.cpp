@@ -56,20 +56,59 @@ TABLE &TABLE::column(std::string name, ColumnType type, int options, std::string
     if (options & DEFAULT)
         columnDefinition += " DEFAULT '" + std::string(defaultValue) + "'";
 
-    columns.push_back(columnDefinition);
+    columns.push_back({name, columnDefinition});
     return *this;
 }
 
-void TABLE::execute() const
+TABLE &TABLE::index(std::string name, std::vector<std::string> columns, bool unique)
+{
+    ASSERT(!name.empty());
+    ASSERT(!columns.empty());
+    std::string indexDefinition = std::string("CREATE ") + (unique ? "UNIQUE " : "") +
+                                  "INDEX IF NOT EXISTS \"" + name + "\" ON \"" + tableName + "\" (";
+    for (auto &column : columns)
+    {
+        ASSERT(!column.empty());
+        indexDefinition += "\"" + column + "\", ";
+    }
+    indexDefinition.erase(indexDefinition.end() - 2, indexDefinition.end());
+    indexDefinition += ")";
+
+    indexes.push_back(indexDefinition);
+    return *this;
+}
+
+std::vector<std::string> TABLE::execute() const
 {
     std::string sql = "CREATE TABLE IF NOT EXISTS " + std::string(tableName) + " (";
     for (size_t i = 0; i < columns.size(); ++i)
     {
-        sql += columns[i];
+        sql += columns[i].second;
         if (i < columns.size() - 1)
             sql += ", ";
     }
     sql += ")";
 
     ASSERT_DATABASE_OK(sqlite3_exec(conn, sql.c_str(), nullptr, nullptr, nullptr));
+
+    std::unordered_map<std::string, bool> existingColumns;
+    sqlite3_stmt *stmt = nullptr;
+    ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, ("PRAGMA table_info(\"" + tableName + "\")").c_str(), -1, &stmt, nullptr));
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        existingColumns[reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1))] = true;
+    ASSERT_DATABASE_OK(sqlite3_finalize(stmt));
+
+    // Columns added after the table was first created; ALTER TABLE needs a DEFAULT for NOT NULL ones
+    std::vector<std::string> addedColumns;
+    for (const auto &column : columns)
+        if (!existingColumns.count(column.first))
+        {
+            std::string alter = "ALTER TABLE \"" + tableName + "\" ADD COLUMN " + column.second;
+            ASSERT_DATABASE_OK(sqlite3_exec(conn, alter.c_str(), nullptr, nullptr, nullptr));
+            addedColumns.push_back(column.first);
+        }
+
+    for (auto &index : indexes)
+        ASSERT_DATABASE_OK(sqlite3_exec(conn, index.c_str(), nullptr, nullptr, nullptr));
+    return addedColumns;
 }
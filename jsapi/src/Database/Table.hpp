@@ -28,7 +28,8 @@ class TABLE
 private:
     sqlite3 *conn;
     std::string tableName;
-    std::vector<std::string> columns;
+    std::vector<std::pair<std::string, std::string>> columns;
+    std::vector<std::string> indexes;
 
 public:
     enum ColumnType
@@ -49,5 +50,8 @@ public:
 
     TABLE(sqlite3 *conn, std::string tableName);
     [[nodiscard]] TABLE &column(std::string name, ColumnType type = TEXT, int options = 0, std::string defaultValue = "");
-    void execute() const;
+    [[nodiscard]] TABLE &index(std::string name, std::vector<std::string> columns, bool unique = false);
+    // Creates the table, adds any declared column an existing table lacks, then
+    // creates the indexes; returns the names of the columns that were added
+    std::vector<std::string> execute() const;
 };
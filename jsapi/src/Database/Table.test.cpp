@@ -0,0 +1,87 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+// Creates the conversation and IME schemas through the same functions the
+// app uses, then checks with EXPLAIN QUERY PLAN that each hot query is
+// answered through its index.
+
+#include "Database.hpp"
+#include "AI/ConversationSchema.hpp"
+#include "IME/IMESchema.hpp"
+#include <iostream>
+#include <vector>
+
+// The query plan details joined by "; ", e.g. "SEARCH conversation_nodes USING INDEX ..."
+static std::string queryPlan(DATABASE &database, const std::string &sql)
+{
+    std::string plan;
+    auto statement = database.prepare("EXPLAIN QUERY PLAN " + sql);
+    while (statement->step())
+        plan += (plan.empty() ? "" : "; ") + statement->columnText(3);
+    return plan;
+}
+
+int main()
+{
+    DATABASE database(":memory:");
+    ConversationSchema::create(database);
+    IMESchema::create(database);
+
+    // Each query as the builders write it, with the index its plan must use
+    const std::vector<std::pair<std::string, std::string>> queries = {
+        {"SELECT \"id\", \"content\" FROM \"conversation_nodes\" WHERE (\"conversation_id\"=?)",
+         "idx_conversation_nodes_conversation_id"},
+        {"DELETE FROM \"conversation_nodes\" WHERE (\"conversation_id\"=?)",
+         "idx_conversation_nodes_conversation_id"},
+        {"SELECT \"id\", \"title\", \"updated_at\" FROM \"conversations\" ORDER BY \"updated_at\" DESC, \"id\" DESC LIMIT 20",
+         "idx_conversations_updated_at_id"},
+        {"SELECT \"id\", \"title\", \"updated_at\" FROM \"conversations\" WHERE (((\"updated_at\"<?) OR (\"updated_at\"=? AND \"id\"<?))) "
+         "ORDER BY \"updated_at\" DESC, \"id\" DESC LIMIT 20",
+         "idx_conversations_updated_at_id"},
+        {"SELECT \"freq\" FROM \"ime_dict\" WHERE (\"pinyin\"=? AND \"hanZi\"=?)",
+         "idx_ime_dict_pinyin_hanzi"},
+    };
+
+    int failures = 0;
+    for (const auto &query : queries)
+    {
+        std::string plan = queryPlan(database, query.first);
+        if (plan.find("USING INDEX " + query.second) == std::string::npos &&
+            plan.find("USING COVERING INDEX " + query.second) == std::string::npos)
+        {
+            std::cerr << "FAIL: " << query.first << "\n  expected " << query.second << "\n  got " << plan << std::endl;
+            ++failures;
+        }
+    }
+
+    // The IME upsert names (pinyin, hanZi) as its conflict target, which only a unique index on both makes valid
+    for (double freq : {500.0, 600.0})
+        database.insert("ime_dict")
+            .value("pinyin", "ni hao")
+            .value("hanZi", "你好")
+            .value("freq", freq)
+            .onConflict({"pinyin", "hanZi"})
+            .doUpdate("freq")
+            .execute();
+    auto rows = database.select("ime_dict").select("freq").execute();
+    if (rows.size() != 1 || std::stod(rows[0]["freq"]) != 600)
+    {
+        std::cerr << "FAIL: ime_dict upsert" << std::endl;
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
@@ -29,31 +29,20 @@ UPDATE &UPDATE::set(std::string column, std::string value)
     this->columns.push_back({column, value});
     return *this;
 }
-UPDATE &UPDATE::where(std::string column, std::string value)
-{
-    this->conditions.push_back({column, value});
-    return *this;
-}
 void UPDATE::execute() const
 {
     std::string query = "UPDATE \"" + tableName + "\" SET ";
     for (auto &column : columns)
         query += "\"" + column.first + "\"=?, ";
     query.erase(query.end() - 2, query.end());
-    if (!conditions.empty())
-    {
-        query += " WHERE ";
-        for (auto &condition : conditions)
-            query += "\"" + condition.first + "\"=? AND ";
-        query.erase(query.end() - 5, query.end());
-    }
+    if (!empty())
+        query += " WHERE " + toString();
     sqlite3_stmt *stmt = nullptr;
     ASSERT_DATABASE_OK(sqlite3_prepare_v2(conn, query.c_str(), -1, &stmt, nullptr));
     int idx = 1;
     for (auto &column : columns)
         ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, idx++, column.second.c_str(), -1, SQLITE_TRANSIENT));
-    for (auto &condition : conditions)
-        ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, idx++, condition.second.c_str(), -1, SQLITE_TRANSIENT));
+    bind(conn, stmt, idx);
     ASSERT_DATABASE_OK(sqlite3_step(stmt));
     ASSERT_DATABASE_OK(sqlite3_finalize(stmt));
 }
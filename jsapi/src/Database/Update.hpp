@@ -18,15 +18,15 @@
 #pragma once
 
 #include "Includes.hpp"
+#include "Where.hpp"
 #include <vector>
 
-class UPDATE
+class UPDATE : public WHERE<UPDATE>
 {
 private:
     sqlite3 *conn;
     std::string tableName;
     std::vector<std::pair<std::string, std::string>> columns;
-    std::vector<std::pair<std::string, std::string>> conditions;
 
 public:
     UPDATE(sqlite3 *conn, std::string tableName);
@@ -36,11 +36,5 @@ public:
     {
         return set(column, std::to_string(data));
     }
-    [[nodiscard]] UPDATE &where(std::string col, std::string value);
-    template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
-    [[nodiscard]] UPDATE &where(std::string column, T data)
-    {
-        return where(column, std::to_string(data));
-    }
     void execute() const;
 };
@@ -0,0 +1,115 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Where.hpp"
+
+void CONDITIONS::addCompare(std::string column, OPERATOR op, std::string value)
+{
+    addCompare(column, op, VALUE(std::move(value)));
+}
+void CONDITIONS::addCompare(std::string column, OPERATOR op, int64_t value)
+{
+    addCompare(column, op, VALUE(value));
+}
+void CONDITIONS::addCompare(std::string column, OPERATOR op, VALUE value)
+{
+    ASSERT(!column.empty());
+    static const char *operators[] = {"=", "!=", "<", "<=", ">", ">=", " LIKE "};
+    ASSERT(op >= EQ && op <= LIKE);
+    clauses.push_back("\"" + column + "\"" + operators[op] + "?");
+    values.push_back(std::move(value));
+}
+void CONDITIONS::addIn(std::string column, std::vector<std::string> values, bool negate)
+{
+    ASSERT(!column.empty());
+    if (values.empty())
+    {
+        // IN () is not valid SQL; an empty list matches nothing, NOT IN matches everything
+        clauses.push_back(negate ? "1" : "0");
+        return;
+    }
+    std::string clause = "\"" + column + "\"" + (negate ? " NOT IN (" : " IN (");
+    for (auto &value : values)
+    {
+        clause += "?, ";
+        this->values.push_back(value);
+    }
+    clause.erase(clause.end() - 2, clause.end());
+    clauses.push_back(clause + ")");
+}
+void CONDITIONS::addNull(std::string column, bool isNull)
+{
+    ASSERT(!column.empty());
+    clauses.push_back("\"" + column + "\"" + (isNull ? " IS NULL" : " IS NOT NULL"));
+}
+void CONDITIONS::addAny(const std::vector<CONDITION> &alternatives)
+{
+    ASSERT(!alternatives.empty());
+    std::string clause = "(";
+    for (auto &alternative : alternatives)
+    {
+        ASSERT(!alternative.empty());
+        clause += alternative.toString() + " OR ";
+        values.insert(values.end(), alternative.values.begin(), alternative.values.end());
+    }
+    clause.erase(clause.end() - 4, clause.end());
+    clauses.push_back(clause + ")");
+}
+void CONDITIONS::addSeek(std::vector<std::string> columns, std::vector<std::string> cursor, bool forward)
+{
+    ASSERT(!columns.empty());
+    ASSERT(columns.size() == cursor.size());
+    // (a > ?) OR (a = ? AND b > ?) ... instead of a row value, so the
+    // leading column can still drive an index range scan
+    std::string comparison = forward ? ">" : "<";
+    std::string clause = "(";
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        clause += "(";
+        for (size_t j = 0; j < i; ++j)
+        {
+            clause += "\"" + columns[j] + "\"=? AND ";
+            values.push_back(cursor[j]);
+        }
+        clause += "\"" + columns[i] + "\"" + comparison + "?) OR ";
+        values.push_back(cursor[i]);
+    }
+    clause.erase(clause.end() - 4, clause.end());
+    clauses.push_back(clause + ")");
+}
+
+bool CONDITIONS::empty() const
+{
+    return clauses.empty();
+}
+std::string CONDITIONS::toString() const
+{
+    std::string query = "(";
+    for (auto &clause : clauses)
+        query += clause + " AND ";
+    query.erase(query.end() - 5, query.end());
+    return query + ")";
+}
+void CONDITIONS::bind(sqlite3 *conn, sqlite3_stmt *stmt, int &idx) const
+{
+    for (auto &value : values)
+        if (value.isInteger)
+            ASSERT_DATABASE_OK(sqlite3_bind_int64(stmt, idx++, value.integer));
+        else
+            ASSERT_DATABASE_OK(sqlite3_bind_text(stmt, idx++, value.text.c_str(), -1, SQLITE_TRANSIENT));
+}
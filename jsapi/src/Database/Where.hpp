@@ -0,0 +1,155 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "Includes.hpp"
+#include <vector>
+#include <type_traits>
+
+class CONDITION;
+
+// Condition storage shared by every statement that takes a WHERE clause.
+// Clauses are ANDed together; values are always bound, never inlined.
+class CONDITIONS
+{
+public:
+    enum OPERATOR
+    {
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+        LIKE,
+    };
+
+protected:
+    // Bound as TEXT unless isInteger; a column without type affinity only
+    // compares numerically against an INTEGER parameter
+    struct VALUE
+    {
+        std::string text;
+        bool isInteger = false;
+        int64_t integer = 0;
+
+        VALUE(std::string text) : text(std::move(text)) {}
+        VALUE(int64_t integer) : isInteger(true), integer(integer) {}
+    };
+
+    std::vector<std::string> clauses;
+    std::vector<VALUE> values;
+
+    void addCompare(std::string column, OPERATOR op, std::string value);
+    void addCompare(std::string column, OPERATOR op, int64_t value);
+    void addCompare(std::string column, OPERATOR op, VALUE value);
+    void addIn(std::string column, std::vector<std::string> values, bool negate);
+    void addNull(std::string column, bool isNull);
+    void addAny(const std::vector<CONDITION> &alternatives);
+    void addSeek(std::vector<std::string> columns, std::vector<std::string> cursor, bool forward);
+
+public:
+    bool empty() const;
+    std::string toString() const;
+    void bind(sqlite3 *conn, sqlite3_stmt *stmt, int &idx) const;
+};
+
+template <typename T>
+class WHERE : public CONDITIONS
+{
+private:
+    T &self() { return static_cast<T &>(*this); }
+
+public:
+    [[nodiscard]] T &where(std::string column, std::string value)
+    {
+        ASSERT(!value.empty());
+        addCompare(column, EQ, value);
+        return self();
+    }
+    template <typename V, std::enable_if_t<std::is_floating_point_v<V>, int> = 0>
+    [[nodiscard]] T &where(std::string column, V data)
+    {
+        return where(column, std::to_string(data));
+    }
+    template <typename V, std::enable_if_t<std::is_integral_v<V>, int> = 0>
+    [[nodiscard]] T &where(std::string column, V data)
+    {
+        addCompare(column, EQ, (int64_t)data);
+        return self();
+    }
+    [[nodiscard]] T &where(std::string column, OPERATOR op, std::string value)
+    {
+        addCompare(column, op, value);
+        return self();
+    }
+    template <typename V, std::enable_if_t<std::is_floating_point_v<V>, int> = 0>
+    [[nodiscard]] T &where(std::string column, OPERATOR op, V data)
+    {
+        return where(column, op, std::to_string(data));
+    }
+    template <typename V, std::enable_if_t<std::is_integral_v<V>, int> = 0>
+    [[nodiscard]] T &where(std::string column, OPERATOR op, V data)
+    {
+        addCompare(column, op, (int64_t)data);
+        return self();
+    }
+    [[nodiscard]] T &whereIn(std::string column, std::vector<std::string> values)
+    {
+        addIn(column, values, false);
+        return self();
+    }
+    [[nodiscard]] T &whereNotIn(std::string column, std::vector<std::string> values)
+    {
+        addIn(column, values, true);
+        return self();
+    }
+    [[nodiscard]] T &whereNull(std::string column)
+    {
+        addNull(column, true);
+        return self();
+    }
+    [[nodiscard]] T &whereNotNull(std::string column)
+    {
+        addNull(column, false);
+        return self();
+    }
+    // Matches when any of the groups matches: (a AND b) OR (c)
+    [[nodiscard]] T &orWhere(const std::vector<CONDITION> &alternatives)
+    {
+        addAny(alternatives);
+        return self();
+    }
+    // Keyset pagination: rows strictly after (or before) cursor in the
+    // lexicographic order of columns. Pair with a matching order().
+    [[nodiscard]] T &after(std::vector<std::string> columns, std::vector<std::string> cursor)
+    {
+        addSeek(columns, cursor, true);
+        return self();
+    }
+    [[nodiscard]] T &before(std::vector<std::string> columns, std::vector<std::string> cursor)
+    {
+        addSeek(columns, cursor, false);
+        return self();
+    }
+};
+
+class CONDITION : public WHERE<CONDITION>
+{
+};
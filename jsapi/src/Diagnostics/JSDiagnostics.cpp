@@ -0,0 +1,394 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "JSDiagnostics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <regex>
+#include <stdexcept>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+namespace
+{
+    const std::string DATABASE_DIRECTORY = "/userdisk/database";
+    // Backups from JS may only be written here, never over a live database
+    const std::string BACKUP_DIRECTORY = "/userdisk/database/backup";
+
+    // The canonical path of an existing file, or "" when it does not exist
+    std::string canonicalPath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? resolved : "";
+    }
+
+    // A database some module has open, or any other database file under DATABASE_DIRECTORY
+    void checkBackupSource(const std::string &source)
+    {
+        auto open = DatabaseExecutor::openDatabases();
+        if (std::find(open.begin(), open.end(), source) != open.end())
+            return;
+        std::string resolved = canonicalPath(source);
+        struct stat sourceStat;
+        if (resolved.empty() || stat(resolved.c_str(), &sourceStat) != 0 || !S_ISREG(sourceStat.st_mode))
+            throw std::runtime_error("Backup source does not exist: " + source);
+        std::string directory = canonicalPath(DATABASE_DIRECTORY);
+        if (directory.empty() || resolved.rfind(directory + "/", 0) != 0)
+            throw std::runtime_error("Backup source must be under " + DATABASE_DIRECTORY + ": " + source);
+    }
+
+    // A plain file name directly in BACKUP_DIRECTORY, which is created on first use
+    void checkBackupDestination(const std::string &destination)
+    {
+        std::string prefix = BACKUP_DIRECTORY + "/";
+        if (destination.rfind(prefix, 0) != 0 ||
+            !std::regex_match(destination.substr(prefix.size()), std::regex("[A-Za-z0-9_-][A-Za-z0-9_.-]{0,127}")))
+            throw std::runtime_error("Backup destination must be a file in " + BACKUP_DIRECTORY + ": " + destination);
+        if (mkdir(BACKUP_DIRECTORY.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("Cannot create " + BACKUP_DIRECTORY);
+    }
+
+    Bson histogramToBson(const TimingHistogram &histogram)
+    {
+        Bson::array buckets;
+        for (uint64_t bucket : histogram.buckets)
+            buckets.push_back((double)bucket);
+        return Bson::object{
+            {"count", (double)histogram.count},
+            {"avgMs", histogram.count ? histogram.totalMs / histogram.count : 0.0},
+            {"maxMs", histogram.maxMs},
+            {"p50Ms", histogram.percentile(0.5)},
+            {"p90Ms", histogram.percentile(0.9)},
+            {"buckets", buckets}};
+    }
+
+    Bson timingToBson(const RequestTiming &timing)
+    {
+        return Bson::object{
+            {"nameLookupMs", timing.nameLookupMs},
+            {"connectMs", timing.connectMs},
+            {"appConnectMs", timing.appConnectMs},
+            {"startTransferMs", timing.startTransferMs},
+            {"totalMs", timing.totalMs},
+            {"downloadSpeed", timing.downloadSpeed},
+            {"uploadSpeed", timing.uploadSpeed},
+            {"downloadBytes", (double)timing.downloadBytes},
+            {"uploadBytes", (double)timing.uploadBytes},
+            {"headerBytes", (double)timing.headerBytes},
+            {"reusedConnection", timing.reusedConnection},
+            {"events", (double)timing.events},
+            {"firstEventMs", timing.firstEventMs},
+            {"maxEventGapMs", timing.maxEventGapMs},
+            {"avgEventGapMs", timing.events > 1 ? timing.totalEventGapMs / (timing.events - 1) : 0.0}};
+    }
+}
+
+JSDiagnostics::JSDiagnostics() {}
+JSDiagnostics::~JSDiagnostics() {}
+
+void JSDiagnostics::setProfiling(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 1 && info.Length() <= 2);
+        JSContext *ctx = info.GetContext();
+        bool enabled = JQBool(ctx, info[0]).getBool();
+        if (enabled)
+        {
+            double slowThresholdMs = info.Length() == 2 ? JQNumber(ctx, info[1]).getDouble() : 100;
+            ASSERT(slowThresholdMs >= 0);
+            DatabaseProfiler::enable(slowThresholdMs);
+        }
+        else
+            DatabaseProfiler::disable();
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::getQueryStats(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        Bson::array result;
+        for (const auto &stat : DatabaseProfiler::snapshot())
+            result.push_back(Bson::object{
+                {"database", stat.database},
+                {"sql", stat.sql},
+                {"count", (double)stat.count},
+                {"rows", (double)stat.rows},
+                {"totalMs", stat.totalMs},
+                {"maxMs", stat.maxMs},
+                {"avgMs", stat.totalMs / stat.count}});
+        info.GetReturnValue().Set(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::getSlowQueries(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        Bson::array result;
+        for (const auto &query : DatabaseProfiler::slowQueries())
+            result.push_back(Bson::object{
+                {"database", query.database},
+                {"sql", query.sql},
+                {"ms", query.ms},
+                {"timestamp", (double)query.timestamp}});
+        info.GetReturnValue().Set(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::resetQueryStats(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        DatabaseProfiler::reset();
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+
+void JSDiagnostics::getConnectionStats(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        ConnectionStats stats = CurlPool::stats();
+        info.GetReturnValue().Set(Bson::object{
+            {"requests", (double)stats.requests},
+            {"newConnections", (double)stats.newConnections},
+            {"reusedConnections", (double)stats.reusedConnections},
+            {"reuseRate", stats.requests ? (double)stats.reusedConnections / stats.requests : 0.0},
+            {"handshakeMs", stats.handshakeMs},
+            {"savedMs", stats.savedMs},
+            {"savedMsPerRequest", stats.requests ? stats.savedMs / stats.requests : 0.0},
+            {"idleHandles", (double)stats.idleHandles}});
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::resetConnectionStats(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        CurlPool::reset();
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::getResponseCacheStats(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        ResponseCacheStats stats = ResponseCache::stats();
+        info.post(Bson::object{
+            {"hits", (double)stats.hits},
+            {"revalidated", (double)stats.revalidated},
+            {"misses", (double)stats.misses},
+            {"entries", (double)stats.entries},
+            {"bytes", (double)stats.bytes},
+            {"maxBytes", (double)ResponseCache::MAX_BYTES}});
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDiagnostics::clearResponseCache(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        ResponseCache::clear();
+        info.post(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDiagnostics::getNetworkTimings(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        Bson::array bounds;
+        for (double bound : TimingHistogram::BOUNDS)
+            bounds.push_back(bound);
+        Bson::array hosts;
+        for (const auto &host : NetworkTiming::snapshot())
+            hosts.push_back(Bson::object{
+                {"host", host.host},
+                {"requests", (double)host.requests},
+                {"failures", (double)host.failures},
+                {"downloadBytes", (double)host.downloadBytes},
+                {"uploadBytes", (double)host.uploadBytes},
+                {"dns", histogramToBson(host.dns)},
+                {"connect", histogramToBson(host.connect)},
+                {"tls", histogramToBson(host.tls)},
+                {"wait", histogramToBson(host.wait)},
+                {"transfer", histogramToBson(host.transfer)},
+                {"total", histogramToBson(host.total)},
+                {"firstEvent", histogramToBson(host.firstEvent)},
+                {"eventGap", histogramToBson(host.eventGap)}});
+        Bson::array recent;
+        for (const auto &request : NetworkTiming::recent())
+            recent.push_back(Bson::object{
+                {"method", request.method},
+                {"host", request.host},
+                {"path", request.path},
+                {"status", (double)request.status},
+                {"failed", request.failed},
+                {"timestamp", (double)request.timestamp},
+                {"timing", timingToBson(request.timing)}});
+        info.GetReturnValue().Set(Bson::object{
+            {"bounds", bounds},
+            {"hosts", hosts},
+            {"recent", recent}});
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+void JSDiagnostics::resetNetworkTimings(JQFunctionInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        NetworkTiming::reset();
+        info.GetReturnValue().Set(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.GetReturnValue().ThrowInternalError(e.what());
+    }
+}
+
+void JSDiagnostics::backupDatabase(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() >= 2 && info.Length() <= 3);
+        ASSERT(info[0].is_string());
+        ASSERT(info[1].is_string());
+        std::string source = info[0].string_value();
+        std::string destination = info[1].string_value();
+        int pagesPerStep = info.Length() == 3 ? info[2].int_value() : 64;
+        checkBackupSource(source);
+        checkBackupDestination(destination);
+
+        BackupProgress progress = [this, source](int remaining, int total)
+        {
+            publish("backup_progress", Bson::object{
+                                           {"source", source},
+                                           {"remaining", remaining},
+                                           {"total", total}});
+        };
+        // Prefer the executor the owning module already has open, so its own
+        // writes during the backup do not force a restart; the steps run as
+        // jobs on its thread, in between the module's own work
+        if (!DatabaseExecutor::withOpenExecutor(source, [&](DatabaseExecutor &executor)
+                                                { executor.backupTo(destination, pagesPerStep, progress); }))
+        {
+            DatabaseExecutor executor(source, DatabaseOptions::reader());
+            executor.backupTo(destination, pagesPerStep, progress);
+        }
+        info.post(true);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+void JSDiagnostics::getDatabaseStats(JQAsyncInfo &info)
+{
+    try
+    {
+        ASSERT(info.Length() == 0);
+        Bson::array result;
+        // Each connection is only touched by its own executor's thread
+        for (const auto &filePath : DatabaseExecutor::openDatabases())
+            DatabaseExecutor::withOpenExecutor(filePath, [&result](DatabaseExecutor &executor)
+                                               {
+                                                   DatabaseStats stats = executor.read([](DATABASE &database)
+                                                                                       { return database.stats(); })
+                                                                             .get();
+                                                   result.push_back(Bson::object{
+                                                       {"database", stats.filePath},
+                                                       {"pageSize", (double)stats.pageSize},
+                                                       {"pageCount", (double)stats.pageCount},
+                                                       {"freelistCount", (double)stats.freelistCount},
+                                                       {"fileSize", (double)stats.fileSize()},
+                                                       {"walSize", (double)stats.walSize},
+                                                       {"fragmentation", stats.fragmentation()},
+                                                       {"autoVacuum", stats.autoVacuum}}); });
+        info.post(result);
+    }
+    catch (const std::exception &e)
+    {
+        info.postError(e.what());
+    }
+}
+
+JSValue createDiagnostics(JQModuleEnv *env)
+{
+    JQFunctionTemplateRef tpl = JQFunctionTemplate::New(env, "Diagnostics");
+    tpl->InstanceTemplate()->setObjectCreator([]()
+                                              { return new JSDiagnostics(); });
+
+    tpl->SetProtoMethod("setProfiling", &JSDiagnostics::setProfiling);
+    tpl->SetProtoMethod("getQueryStats", &JSDiagnostics::getQueryStats);
+    tpl->SetProtoMethod("getSlowQueries", &JSDiagnostics::getSlowQueries);
+    tpl->SetProtoMethod("resetQueryStats", &JSDiagnostics::resetQueryStats);
+    tpl->SetProtoMethod("getConnectionStats", &JSDiagnostics::getConnectionStats);
+    tpl->SetProtoMethod("resetConnectionStats", &JSDiagnostics::resetConnectionStats);
+    tpl->SetProtoMethodPromise("getResponseCacheStats", &JSDiagnostics::getResponseCacheStats);
+    tpl->SetProtoMethodPromise("clearResponseCache", &JSDiagnostics::clearResponseCache);
+    tpl->SetProtoMethod("getNetworkTimings", &JSDiagnostics::getNetworkTimings);
+    tpl->SetProtoMethod("resetNetworkTimings", &JSDiagnostics::resetNetworkTimings);
+
+    tpl->SetProtoMethodPromise("backupDatabase", &JSDiagnostics::backupDatabase);
+    tpl->SetProtoMethodPromise("getDatabaseStats", &JSDiagnostics::getDatabaseStats);
+
+    JSDiagnostics::InitTpl(tpl);
+    return tpl->CallConstructor();
+}
@@ -0,0 +1,52 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <jqutil_v2/jqutil.h>
+#include "Database/DatabaseExecutor.hpp"
+#include "Database/Profiler.hpp"
+#include "CurlPool.hpp"
+#include "ResponseCache.hpp"
+#include "NetworkTiming.hpp"
+
+using namespace JQUTIL_NS;
+
+class JSDiagnostics : public JQPublishObject
+{
+public:
+    JSDiagnostics();
+    ~JSDiagnostics();
+
+    void setProfiling(JQFunctionInfo &info);
+    void getQueryStats(JQFunctionInfo &info);
+    void getSlowQueries(JQFunctionInfo &info);
+    void resetQueryStats(JQFunctionInfo &info);
+
+    void getConnectionStats(JQFunctionInfo &info);
+    void resetConnectionStats(JQFunctionInfo &info);
+    void getResponseCacheStats(JQAsyncInfo &info);
+    void clearResponseCache(JQAsyncInfo &info);
+    void getNetworkTimings(JQFunctionInfo &info);
+    void resetNetworkTimings(JQFunctionInfo &info);
+
+    void backupDatabase(JQAsyncInfo &info);
+    void getDatabaseStats(JQAsyncInfo &info);
+};
+
+extern JSValue createDiagnostics(JQModuleEnv *env);
@@ -16,9 +16,12 @@
 // along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Fetch.hpp"
+#include "CurlPool.hpp"
+#include "ResponseCache.hpp"
 #include "strUtils.hpp"
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <algorithm>
 
 Response::Response(int status, std::string body) : status(status), body(body), ok(status >= 200 && status < 300) {}
 nlohmann::json Response::json()
@@ -52,28 +55,10 @@ static int xferinfo(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_of
 size_t Fetch::StreamWriteCallback(void *contents, size_t size, size_t nmemb, void *userdata)
 {
     size_t totalSize = size * nmemb;
-    try
-    {
-        const FetchOptions *options = static_cast<const FetchOptions *>(userdata);
-        if (options && options->cancelled && options->cancelled->load())
-            return 0;
-        if (options && options->streamCallback)
-        {
-            std::string chunk((char *)contents, totalSize);
-            std::istringstream stream(chunk);
-            std::string line;
-            while (std::getline(stream, line))
-            {
-                line = strUtils::trimEnd(line);
-                if (line.substr(0, 6) == "data: ")
-                    options->streamCallback(line.substr(6));
-            }
-        }
-    }
-    catch (const std::exception &e)
-    {
-        std::cerr << "Stream write callback error: " << e.what() << std::endl;
-    }
+    StreamState *state = static_cast<StreamState *>(userdata);
+    if (state->options->cancelled && state->options->cancelled->load())
+        return 0;
+    state->decoder->feed(std::string_view((char *)contents, totalSize));
     return totalSize;
 }
 size_t Fetch::HeaderCallback(char *buffer, size_t size, size_t nitems, std::unordered_map<std::string, std::string> *headers)
@@ -91,19 +76,38 @@ size_t Fetch::HeaderCallback(char *buffer, size_t size, size_t nitems, std::unor
     return totalSize;
 }
 
-Response Fetch::fetch(const std::string &url, const FetchOptions &options)
-{
-    CURL *curl = curl_easy_init();
-    if (!curl)
-        THROW_CURL_ERROR(CURLE_FAILED_INIT);
+Fetch::Transfer::Transfer(const FetchOptions &options, SseCallback onEvent)
+    : options(options),
+      decoder([this, onEvent = std::move(onEvent)](const SseEvent &event)
+              {
+                  markEvent();
+                  onEvent(event); }),
+      streamState{&options, &decoder}, headerList(nullptr, curl_slist_free_all) {}
 
-    long responseCode = 0;
-    std::string responseBody;
-    std::unordered_map<std::string, std::string> responseHeaders;
+bool Fetch::Transfer::streaming() const { return options.stream && options.streamCallback; }
+bool Fetch::Transfer::cancelled() const { return options.cancelled && options.cancelled->load(); }
+void Fetch::Transfer::markEvent()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (timing.events == 0)
+        timing.firstEventMs = std::chrono::duration<double, std::milli>(now - started).count();
+    else
+    {
+        double gapMs = std::chrono::duration<double, std::milli>(now - lastEvent).count();
+        eventGaps.add(gapMs);
+        timing.maxEventGapMs = std::max(timing.maxEventGapMs, gapMs);
+        timing.totalEventGapMs += gapMs;
+    }
+    timing.events++;
+    lastEvent = now;
+}
 
+void Fetch::configure(CURL *curl, const std::string &url, Transfer &transfer)
+{
+    const FetchOptions &options = transfer.options;
     ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_URL, url.c_str()));
     ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback));
-    ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_HEADERDATA, &responseHeaders));
+    ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer.headers));
     if (options.timeout > 0)
         ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_TIMEOUT, options.timeout));
     ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, options.followRedirects ? 1L : 0L));
@@ -117,15 +121,15 @@ Response Fetch::fetch(const std::string &url, const FetchOptions &options)
         ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L));
     }
 
-    if (options.stream && options.streamCallback)
+    if (transfer.streaming())
     {
         ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamWriteCallback));
-        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &options));
+        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer.streamState));
     }
     else
     {
         ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback));
-        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseBody));
+        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer.body));
     }
 
     if (options.method == "GET")
@@ -143,21 +147,112 @@ Response Fetch::fetch(const std::string &url, const FetchOptions &options)
             ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_POSTFIELDS, options.body.c_str()));
     }
 
-    struct curl_slist *headers = nullptr;
     for (const auto &header : options.headers)
-        headers = curl_slist_append(headers, std::string(header.first + ": " + header.second).c_str());
-    if (headers)
-        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers));
+    {
+        curl_slist *appended = curl_slist_append(transfer.headerList.get(), std::string(header.first + ": " + header.second).c_str());
+        // On failure curl_slist_append returns NULL and leaves the existing list untouched
+        if (!appended)
+            THROW_CURL_ERROR(CURLE_OUT_OF_MEMORY);
+        transfer.headerList.release();
+        transfer.headerList.reset(appended);
+    }
+    if (transfer.headerList)
+        ASSERT_CURL_OK(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headerList.get()));
+    transfer.started = std::chrono::steady_clock::now();
+}
 
-    ASSERT_CURL_OK(curl_easy_perform(curl));
+void Fetch::measure(CURL *curl, const std::string &url, Transfer &transfer, CURLcode result)
+{
+    RequestTiming &timing = transfer.timing;
+    curl_off_t value = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &value) == CURLE_OK)
+        timing.nameLookupMs = value / 1000.0;
+    if (curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &value) == CURLE_OK)
+        timing.connectMs = value / 1000.0;
+    if (curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &value) == CURLE_OK)
+        timing.appConnectMs = value / 1000.0;
+    if (curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &value) == CURLE_OK)
+        timing.startTransferMs = value / 1000.0;
+    if (curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &value) == CURLE_OK)
+        timing.totalMs = value / 1000.0;
+    if (curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD_T, &value) == CURLE_OK)
+        timing.downloadSpeed = (double)value;
+    if (curl_easy_getinfo(curl, CURLINFO_SPEED_UPLOAD_T, &value) == CURLE_OK)
+        timing.uploadSpeed = (double)value;
+    if (curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &value) == CURLE_OK)
+        timing.downloadBytes = value;
+    if (curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &value) == CURLE_OK)
+        timing.uploadBytes = value;
+    long number = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &number) == CURLE_OK)
+        timing.headerBytes = number;
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &number) == CURLE_OK)
+        timing.reusedConnection = number == 0 && result == CURLE_OK;
 
-    ASSERT_CURL_OK(curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode));
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    bool failed = result != CURLE_OK && result != CURLE_ABORTED_BY_CALLBACK;
+    NetworkTiming::record(transfer.options.method, url, status, failed, timing, transfer.eventGaps);
+}
+
+Response Fetch::fetch(const std::string &url, const FetchOptions &options)
+{
+    if (options.cacheTtl == 0 || options.method != "GET" || options.stream)
+        return perform(url, options);
+
+    std::string key = ResponseCache::key(url, options);
+    std::unique_ptr<CachedResponse> cached = ResponseCache::lookup(key, url);
+    if (cached && cached->fresh())
+    {
+        ResponseCache::hit(key);
+        return cached->response;
+    }
+
+    FetchOptions conditional = options;
+    if (cached && !cached->etag.empty())
+        conditional.headers["If-None-Match"] = cached->etag;
+    if (cached && !cached->lastModified.empty())
+        conditional.headers["If-Modified-Since"] = cached->lastModified;
+    Response response = perform(url, conditional);
+    if (cached && response.status == 304)
+    {
+        ResponseCache::revalidated(key, options.cacheTtl);
+        cached->response.timing = response.timing;
+        return cached->response;
+    }
+    ResponseCache::store(key, url, response, options.cacheTtl);
+    return response;
+}
+
+Response Fetch::perform(const std::string &url, const FetchOptions &options)
+{
+    CurlPool::Handle handle = CurlPool::acquire(url);
+    CURL *curl = handle.get();
 
-    if (headers)
-        curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    Transfer transfer(options, [&options](const SseEvent &event)
+                      {
+                          try
+                          {
+                              options.streamCallback(event);
+                          }
+                          catch (const std::exception &e)
+                          {
+                              std::cerr << "Stream callback error: " << e.what() << std::endl;
+                          } });
+    configure(curl, url, transfer);
+
+    CURLcode performResult = curl_easy_perform(curl);
+    CurlPool::record(curl);
+    if (transfer.streaming() && performResult == CURLE_OK && !transfer.cancelled())
+        transfer.decoder.finish();
+    measure(curl, url, transfer, performResult);
+    ASSERT_CURL_OK(performResult);
+
+    long responseCode = 0;
+    ASSERT_CURL_OK(curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode));
 
-    Response response(responseCode, responseBody);
-    response.headers = responseHeaders;
+    Response response(responseCode, std::move(transfer.body));
+    response.headers = std::move(transfer.headers);
+    response.timing = transfer.timing;
     return response;
 }
@@ -21,9 +21,13 @@
 #include <unordered_map>
 #include <functional>
 #include <atomic>
+#include <memory>
+#include <chrono>
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
 #include <Exceptions/CurlError.hpp>
+#include "SseDecoder.hpp"
+#include "NetworkTiming.hpp"
 
 #define ASSERT_CURL_OK(expr)                                     \
     do                                                           \
@@ -33,7 +37,7 @@
             THROW_CURL_ERROR(res);                               \
     } while (false)
 
-using StreamCallback = std::function<void(const std::string &chunk)>;
+using StreamCallback = SseCallback;
 
 class Response
 {
@@ -42,6 +46,10 @@ public:
     std::unordered_map<std::string, std::string> headers;
     std::string body;
     bool ok;
+    // Served from ResponseCache without a full transfer (fresh hit or 304)
+    bool cached = false;
+    // Of the transfer that produced this response; all zero for a fresh cache hit
+    RequestTiming timing;
 
     Response(int status, std::string body);
     nlohmann::json json();
@@ -60,6 +68,9 @@ public:
     size_t timeout;
     bool followRedirects = true;
     std::shared_ptr<std::atomic<bool>> cancelled;
+    // Seconds a GET response may be served from ResponseCache without asking the server;
+    // once expired it is revalidated with its ETag/Last-Modified. 0 disables caching.
+    size_t cacheTtl = 0;
 
     FetchOptions(std::string method = "GET",
                  std::unordered_map<std::string, std::string> headers = {},
@@ -76,9 +87,41 @@ public:
 class Fetch
 {
 private:
+    friend class FetchEngine;
+
+    struct StreamState
+    {
+        const FetchOptions *options;
+        SseDecoder *decoder;
+    };
+
+    // Everything a transfer writes into; must stay at a fixed address until it completes
+    struct Transfer
+    {
+        const FetchOptions &options;
+        std::string body;
+        std::unordered_map<std::string, std::string> headers;
+        SseDecoder decoder;
+        StreamState streamState;
+        std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> headerList;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point lastEvent;
+        RequestTiming timing;
+        TimingHistogram eventGaps;
+
+        explicit Transfer(const FetchOptions &options, SseCallback onEvent);
+        bool streaming() const;
+        bool cancelled() const;
+        void markEvent();
+    };
+
     static size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *data);
     static size_t StreamWriteCallback(void *contents, size_t size, size_t nmemb, void *userdata);
     static size_t HeaderCallback(char *buffer, size_t size, size_t nitems, std::unordered_map<std::string, std::string> *headers);
+    static void configure(CURL *curl, const std::string &url, Transfer &transfer);
+    // Fills transfer.timing from curl and adds it to NetworkTiming
+    static void measure(CURL *curl, const std::string &url, Transfer &transfer, CURLcode result);
+    static Response perform(const std::string &url, const FetchOptions &options);
 
 public:
     static Response fetch(const std::string &url, const FetchOptions &options = FetchOptions{});
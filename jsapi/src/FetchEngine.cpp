@@ -0,0 +1,255 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "FetchEngine.hpp"
+#include "CurlPool.hpp"
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+
+namespace
+{
+    class CallbackTask : public JQuick::Task
+    {
+    private:
+        std::function<void()> callback;
+
+    public:
+        explicit CallbackTask(std::function<void()> callback) : callback(std::move(callback)) {}
+        void run() override { callback(); }
+    };
+
+    void deliver(const StreamCallback &callback, const SseEvent &event)
+    {
+        try
+        {
+            callback(event);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Stream callback error: " << e.what() << std::endl;
+        }
+    }
+
+    void dispatch(const JQuick::sp<JQuick::Handler> &handler, std::function<void()> callback)
+    {
+        if (handler != nullptr)
+            handler->post(new CallbackTask(std::move(callback)));
+        else
+            callback();
+    }
+}
+
+struct FetchEngine::Request
+{
+    std::string url;
+    FetchOptions options;
+    Completion completion;
+    JQuick::sp<JQuick::Handler> handler;
+};
+
+// Lives on the I/O thread from submission until the transfer completes
+struct FetchEngine::ActiveTransfer
+{
+    Request request;
+    CurlPool::Handle handle;
+    Fetch::Transfer transfer;
+
+    ActiveTransfer(Request request, CurlPool::Handle handle)
+        : request(std::move(request)), handle(std::move(handle)),
+          transfer(this->request.options, [this](const SseEvent &event)
+                   { onEvent(event); }) {}
+
+    void onEvent(const SseEvent &event)
+    {
+        if (request.handler == nullptr)
+        {
+            deliver(request.options.streamCallback, event);
+            return;
+        }
+        StreamCallback callback = request.options.streamCallback;
+        request.handler->post(new CallbackTask([callback, event]()
+                                               { deliver(callback, event); }));
+    }
+};
+
+struct FetchEngine::State
+{
+    CURLM *multi = nullptr;
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<Request> queue;
+    size_t inFlight = 0;
+    bool stopping = false;
+    std::unordered_map<CURL *, std::unique_ptr<ActiveTransfer>> active;
+
+    ~State()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake();
+        if (thread.joinable())
+            thread.join();
+        if (multi)
+            curl_multi_cleanup(multi);
+    }
+
+    void wake()
+    {
+#if LIBCURL_VERSION_NUM >= 0x074400
+        if (multi)
+            curl_multi_wakeup(multi);
+#endif
+    }
+};
+
+void FetchEngine::complete(State &engine, Request &request, Response response, std::exception_ptr error)
+{
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        engine.inFlight--;
+    }
+    auto completion = std::make_shared<FetchEngine::Completion>(std::move(request.completion));
+    auto result = std::make_shared<Response>(std::move(response));
+    dispatch(request.handler, [completion, result, error]()
+             { (*completion)(*result, error); });
+}
+
+void FetchEngine::start(State &engine, Request request)
+{
+    std::unique_ptr<ActiveTransfer> active;
+    try
+    {
+        CurlPool::Handle handle = CurlPool::acquire(request.url);
+        active = std::make_unique<ActiveTransfer>(std::move(request), std::move(handle));
+        CURL *curl = active->handle.get();
+        Fetch::configure(curl, active->request.url, active->transfer);
+        CURLMcode code = curl_multi_add_handle(engine.multi, curl);
+        if (code != CURLM_OK)
+            throw std::runtime_error(std::string("curl_multi_add_handle: ") + curl_multi_strerror(code));
+        engine.active[curl] = std::move(active);
+    }
+    catch (...)
+    {
+        complete(engine, active ? active->request : request, Response(0, ""), std::current_exception());
+    }
+}
+
+void FetchEngine::finish(State &engine, CURL *curl, CURLcode result)
+{
+    curl_multi_remove_handle(engine.multi, curl);
+    CurlPool::record(curl);
+    auto it = engine.active.find(curl);
+    if (it == engine.active.end())
+        return;
+    std::unique_ptr<ActiveTransfer> active = std::move(it->second);
+    engine.active.erase(it);
+
+    Fetch::Transfer &transfer = active->transfer;
+    Response response(0, "");
+    std::exception_ptr error;
+    try
+    {
+        if (transfer.streaming() && result == CURLE_OK && !transfer.cancelled())
+            transfer.decoder.finish();
+        Fetch::measure(curl, active->request.url, transfer, result);
+        ASSERT_CURL_OK(result);
+        long responseCode = 0;
+        ASSERT_CURL_OK(curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode));
+        response = Response(responseCode, std::move(transfer.body));
+        response.headers = std::move(transfer.headers);
+        response.timing = transfer.timing;
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    Request request = std::move(active->request);
+    // Hands the easy handle back to the pool before the completion runs
+    active.reset();
+    complete(engine, request, std::move(response), error);
+}
+
+void FetchEngine::run(State &engine)
+{
+    while (true)
+    {
+        std::vector<Request> incoming;
+        {
+            std::lock_guard<std::mutex> lock(engine.mutex);
+            if (engine.stopping)
+                break;
+            incoming.swap(engine.queue);
+        }
+        for (auto &request : incoming)
+            start(engine, std::move(request));
+
+        int running = 0;
+        curl_multi_perform(engine.multi, &running);
+        CURLMsg *message;
+        int remaining;
+        while ((message = curl_multi_info_read(engine.multi, &remaining)))
+            if (message->msg == CURLMSG_DONE)
+                finish(engine, message->easy_handle, message->data.result);
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+        curl_multi_poll(engine.multi, nullptr, 0, 1000, nullptr);
+#else
+        curl_multi_wait(engine.multi, nullptr, 0, 50, nullptr);
+#endif
+    }
+    for (auto &entry : engine.active)
+        curl_multi_remove_handle(engine.multi, entry.first);
+    engine.active.clear();
+}
+
+FetchEngine::State &FetchEngine::state()
+{
+    static State instance;
+    static std::once_flag started;
+    std::call_once(started, []()
+                   {
+                       // Initialises curl globally before the multi handle exists
+                       CurlPool::stats();
+                       instance.multi = curl_multi_init();
+                       instance.thread = std::thread(run, std::ref(instance)); });
+    return instance;
+}
+
+void FetchEngine::submit(const std::string &url, const FetchOptions &options, Completion completion,
+                         JQuick::sp<JQuick::Handler> handler)
+{
+    State &engine = state();
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        engine.queue.push_back(Request{url, options, std::move(completion), std::move(handler)});
+        engine.inFlight++;
+    }
+    engine.wake();
+}
+
+size_t FetchEngine::inFlight()
+{
+    State &engine = state();
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    return engine.inFlight;
+}
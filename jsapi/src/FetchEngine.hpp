@@ -0,0 +1,51 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <functional>
+#include <exception>
+#include <jqutil_v2/jqutil.h>
+#include "Fetch.hpp"
+
+// Runs requests on a single I/O thread driving curl_multi, so a long stream does not
+// hold a thread of its own and any number of requests can be in flight at once.
+// Stream events and the completion run on the I/O thread, or are posted to handler
+// when one is given; they must not block.
+class FetchEngine
+{
+public:
+    // error is null on success; response is only meaningful then
+    using Completion = std::function<void(Response &response, std::exception_ptr error)>;
+
+private:
+    struct Request;
+    struct ActiveTransfer;
+    struct State;
+
+    static State &state();
+    static void run(State &engine);
+    static void start(State &engine, Request request);
+    static void finish(State &engine, CURL *curl, CURLcode result);
+    static void complete(State &engine, Request &request, Response response, std::exception_ptr error);
+
+public:
+    static void submit(const std::string &url, const FetchOptions &options, Completion completion,
+                       JQuick::sp<JQuick::Handler> handler = nullptr);
+    static size_t inFlight();
+};
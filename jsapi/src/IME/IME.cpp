@@ -16,6 +16,7 @@
 // along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "IME.hpp"
+#include "IMESchema.hpp"
 #include "strUtils.hpp"
 #include <algorithm>
 #include <sstream>
@@ -23,13 +24,10 @@
 #include <stdlib.h>
 #include "rawdict_data.hpp"
 
-IME::IME() : database("/userdisk/database/langningchen-ime.db")
+IME::IME() : executor("/userdisk/database/langningchen-ime.db", DatabaseOptions::interactive())
 {
-    database.table("ime_dict")
-        .column("pinyin", TABLE::TEXT, TABLE::NOT_NULL)
-        .column("hanZi", TABLE::TEXT, TABLE::NOT_NULL | TABLE::UNIQUE)
-        .column("freq", TABLE::REAL, TABLE::NOT_NULL)
-        .execute();
+    executor.post([](DATABASE &database)
+                  { IMESchema::create(database); });
 
     pinyinDict.reserve(100000);
     pinyinUnits.reserve(500);
@@ -162,7 +160,9 @@ void IME::initialize()
             }
     }
 
-    auto rows = database.select("ime_dict").select("pinyin").select("hanZi").select("freq").execute();
+    auto rows = executor.read([](DATABASE &database)
+                              { return database.select("ime_dict").select("pinyin").select("hanZi").select("freq").execute(); })
+                    .get();
     for (const auto &row : rows)
     {
         Pinyin pinyin = strUtils::split(row.at("pinyin"), " ");
@@ -205,23 +205,14 @@ void IME::updateWordFrequency(const Pinyin &pinyin, const std::string &hanZi)
     insert(pinyin, hanZi, newFreq);
 
     std::string pinyinStr = strUtils::join(pinyin, " ");
-    auto data = database.select("ime_dict").where("pinyin", pinyinStr).where("hanZi", hanZi).execute();
-    if (data.empty())
-    {
-        database.insert("ime_dict")
-            .value("pinyin", pinyinStr)
-            .value("hanZi", hanZi)
-            .value("freq", newFreq)
-            .execute();
-    }
-    else
-    {
-        database.update("ime_dict")
-            .set("freq", std::to_string(newFreq))
-            .where("pinyin", pinyinStr)
-            .where("hanZi", hanZi)
-            .execute();
-    }
+    executor.post([pinyinStr, hanZi, newFreq](DATABASE &database)
+                  { database.insert("ime_dict")
+                        .value("pinyin", pinyinStr)
+                        .value("hanZi", hanZi)
+                        .value("freq", newFreq)
+                        .onConflict({"pinyin", "hanZi"})
+                        .doUpdate("freq")
+                        .execute(); });
 }
 Pinyin IME::splitPinyin(const std::string &rawPinyin)
 {
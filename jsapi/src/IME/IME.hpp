@@ -17,7 +17,7 @@
 
 #pragma once
 
-#include "Database/Database.hpp"
+#include "Database/DatabaseExecutor.hpp"
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -42,7 +42,7 @@ struct DictEntry
 class IME
 {
 private:
-    DATABASE database;
+    DatabaseExecutor executor;
 
     std::unordered_map<std::string, std::vector<DictEntry>> pinyinDict;
     std::unordered_set<std::string> pinyinUnits;
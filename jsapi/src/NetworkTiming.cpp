@@ -0,0 +1,160 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "NetworkTiming.hpp"
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+
+const double TimingHistogram::BOUNDS[TimingHistogram::BUCKETS - 1] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+
+void TimingHistogram::add(double ms)
+{
+    ms = std::max(ms, 0.0);
+    count++;
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+    buckets[std::upper_bound(BOUNDS, BOUNDS + BUCKETS - 1, ms) - BOUNDS]++;
+}
+
+void TimingHistogram::merge(const TimingHistogram &other)
+{
+    count += other.count;
+    totalMs += other.totalMs;
+    maxMs = std::max(maxMs, other.maxMs);
+    for (size_t i = 0; i < BUCKETS; i++)
+        buckets[i] += other.buckets[i];
+}
+
+double TimingHistogram::percentile(double fraction) const
+{
+    if (count == 0)
+        return 0;
+    uint64_t target = std::max<uint64_t>(1, (uint64_t)(fraction * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS - 1; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min(BOUNDS[i], maxMs);
+    }
+    return maxMs;
+}
+
+namespace
+{
+    struct State
+    {
+        std::mutex mutex;
+        std::map<std::string, HostTiming> hosts;
+        std::deque<RecentRequest> recent;
+    };
+
+    State &state()
+    {
+        static State instance;
+        return instance;
+    }
+
+    // Splits scheme://[user@]host[:port]/path?query into a lower-cased host and the path
+    void splitUrl(const std::string &url, std::string &host, std::string &path)
+    {
+        size_t hostBegin = url.find("://");
+        hostBegin = hostBegin == std::string::npos ? 0 : hostBegin + 3;
+        size_t hostEnd = url.find_first_of("/?#", hostBegin);
+        if (hostEnd == std::string::npos)
+            hostEnd = url.size();
+        size_t at = url.rfind('@', hostEnd);
+        if (at != std::string::npos && at >= hostBegin)
+            hostBegin = at + 1;
+        host = url.substr(hostBegin, hostEnd - hostBegin);
+        for (char &c : host)
+            c = std::tolower((unsigned char)c);
+        size_t pathEnd = url.find_first_of("?#", hostEnd);
+        path = url.substr(hostEnd, pathEnd == std::string::npos ? std::string::npos : pathEnd - hostEnd);
+        if (path.empty())
+            path = "/";
+    }
+}
+
+void NetworkTiming::record(const std::string &method, const std::string &url, long status, bool failed,
+                           const RequestTiming &timing, const TimingHistogram &eventGaps)
+{
+    RecentRequest request{method, "", "", status, failed,
+                          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+                          timing};
+    splitUrl(url, request.host, request.path);
+
+    State &timings = state();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    HostTiming &host = timings.hosts[request.host];
+    host.host = request.host;
+    host.requests++;
+    if (failed)
+        host.failures++;
+    host.downloadBytes += timing.downloadBytes;
+    host.uploadBytes += timing.uploadBytes;
+
+    if (!timing.reusedConnection)
+    {
+        host.dns.add(timing.nameLookupMs);
+        host.connect.add(timing.connectMs - timing.nameLookupMs);
+        if (timing.appConnectMs > 0)
+            host.tls.add(timing.appConnectMs - timing.connectMs);
+    }
+    if (timing.startTransferMs > 0)
+    {
+        host.wait.add(timing.startTransferMs - std::max({timing.nameLookupMs, timing.connectMs, timing.appConnectMs}));
+        host.transfer.add(timing.totalMs - timing.startTransferMs);
+    }
+    host.total.add(timing.totalMs);
+    if (timing.events > 0)
+        host.firstEvent.add(timing.firstEventMs);
+    host.eventGap.merge(eventGaps);
+
+    timings.recent.push_back(std::move(request));
+    if (timings.recent.size() > MAX_RECENT)
+        timings.recent.pop_front();
+}
+
+std::vector<HostTiming> NetworkTiming::snapshot()
+{
+    State &timings = state();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    std::vector<HostTiming> result;
+    for (const auto &entry : timings.hosts)
+        result.push_back(entry.second);
+    return result;
+}
+
+std::vector<RecentRequest> NetworkTiming::recent()
+{
+    State &timings = state();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    return std::vector<RecentRequest>(timings.recent.rbegin(), timings.recent.rend());
+}
+
+void NetworkTiming::reset()
+{
+    State &timings = state();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    timings.hosts.clear();
+    timings.recent.clear();
+}
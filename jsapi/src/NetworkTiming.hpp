@@ -0,0 +1,107 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Fixed log-scale buckets, so histograms from any host or request merge by addition
+struct TimingHistogram
+{
+    static const size_t BUCKETS = 12;
+    // Upper bounds in milliseconds; the last bucket has none
+    static const double BOUNDS[BUCKETS - 1];
+
+    uint64_t count = 0;
+    double totalMs = 0;
+    double maxMs = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    void add(double ms);
+    void merge(const TimingHistogram &other);
+    // Upper bound of the bucket holding the given fraction of samples, capped at maxMs
+    double percentile(double fraction) const;
+};
+
+struct RequestTiming
+{
+    // Milliseconds since the transfer started, cumulative as curl reports them
+    double nameLookupMs = 0;
+    double connectMs = 0;
+    double appConnectMs = 0;
+    double startTransferMs = 0;
+    double totalMs = 0;
+    // Bytes per second
+    double downloadSpeed = 0;
+    double uploadSpeed = 0;
+    uint64_t downloadBytes = 0;
+    uint64_t uploadBytes = 0;
+    uint64_t headerBytes = 0;
+    bool reusedConnection = false;
+    // Streaming requests only
+    uint64_t events = 0;
+    double firstEventMs = 0;
+    double maxEventGapMs = 0;
+    double totalEventGapMs = 0;
+};
+
+struct HostTiming
+{
+    std::string host;
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t downloadBytes;
+    uint64_t uploadBytes;
+    // Handshake phases only count requests that opened a new connection
+    TimingHistogram dns;
+    TimingHistogram connect;
+    TimingHistogram tls;
+    // From the request being sent to the first response byte
+    TimingHistogram wait;
+    TimingHistogram transfer;
+    TimingHistogram total;
+    TimingHistogram firstEvent;
+    TimingHistogram eventGap;
+};
+
+struct RecentRequest
+{
+    std::string method;
+    std::string host;
+    // Without the query string, which may carry credentials
+    std::string path;
+    long status;
+    bool failed;
+    int64_t timestamp;
+    RequestTiming timing;
+};
+
+// Per-host aggregation of every Fetch transfer, plus the last few requests in full
+class NetworkTiming
+{
+public:
+    static const size_t MAX_RECENT = 20;
+
+    static void record(const std::string &method, const std::string &url, long status, bool failed,
+                       const RequestTiming &timing, const TimingHistogram &eventGaps);
+
+    static std::vector<HostTiming> snapshot();
+    static std::vector<RecentRequest> recent();
+    static void reset();
+};
@@ -0,0 +1,231 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ResponseCache.hpp"
+#include "Database/DatabaseExecutor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <vector>
+
+namespace
+{
+    struct State
+    {
+        DatabaseExecutor executor{"/userdisk/database/langningchen-http-cache.db", DatabaseOptions::interactive()};
+        std::atomic<uint64_t> hits{0}, revalidated{0}, misses{0};
+
+        State()
+        {
+            executor.post([](DATABASE &database)
+                          { database.table("http_cache")
+                                .column("key", TABLE::TEXT, TABLE::PRIMARY_KEY)
+                                .column("url", TABLE::TEXT, TABLE::NOT_NULL)
+                                .column("status", TABLE::INTEGER, TABLE::NOT_NULL)
+                                .column("headers", TABLE::TEXT, TABLE::NOT_NULL)
+                                .column("body", TABLE::BLOB, TABLE::NOT_NULL)
+                                .column("etag", TABLE::TEXT, TABLE::NOT_NULL)
+                                .column("last_modified", TABLE::TEXT, TABLE::NOT_NULL)
+                                .column("expires_at", TABLE::INTEGER, TABLE::NOT_NULL)
+                                .column("size", TABLE::INTEGER, TABLE::NOT_NULL)
+                                .column("last_used", TABLE::INTEGER, TABLE::NOT_NULL)
+                                .index("idx_http_cache_last_used", {"last_used"})
+                                .execute(); });
+        }
+    };
+
+    State &state()
+    {
+        static State instance;
+        return instance;
+    }
+
+    int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // HTTP/2 responses carry lower-case header names
+    std::string header(const std::unordered_map<std::string, std::string> &headers, const std::string &name)
+    {
+        for (const auto &entry : headers)
+            if (entry.first.size() == name.size() &&
+                std::equal(entry.first.begin(), entry.first.end(), name.begin(), [](char a, char b)
+                           { return std::tolower((unsigned char)a) == std::tolower((unsigned char)b); }))
+                return entry.second;
+        return "";
+    }
+}
+
+bool CachedResponse::fresh() const { return now() < expiresAt; }
+
+std::string ResponseCache::key(const std::string &url, const FetchOptions &options)
+{
+    // Requests that differ in any header, the API key included, are cached apart
+    std::map<std::string, std::string> headers;
+    for (const auto &entry : options.headers)
+    {
+        std::string name = entry.first;
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c)
+                       { return std::tolower(c); });
+        headers[name] = entry.second;
+    }
+    std::string material = options.method + " " + url;
+    for (const auto &entry : headers)
+        material += "\n" + entry.first + ": " + entry.second;
+    // FNV-1a, so keys stay valid across builds; std::hash makes no such promise
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : material)
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return hex;
+}
+
+std::unique_ptr<CachedResponse> ResponseCache::lookup(const std::string &key, const std::string &url)
+{
+    bool corrupt = false;
+    auto cached = state().executor.read([key, url, &corrupt](DATABASE &database) -> std::unique_ptr<CachedResponse>
+                                        {
+                                            auto stmt = database.prepare("SELECT status, headers, body, etag, last_modified, expires_at "
+                                                                         "FROM http_cache WHERE key = ? AND url = ?");
+                                            stmt->bind(1, key).bind(2, url);
+                                            if (!stmt->step())
+                                                return nullptr;
+                                            Response response(stmt->columnInt(0), stmt->columnBlob(2));
+                                            response.cached = true;
+                                            try
+                                            {
+                                                nlohmann::json headers = nlohmann::json::parse(stmt->columnText(1));
+                                                for (const auto &entry : headers.items())
+                                                    response.headers[entry.key()] = entry.value().get<std::string>();
+                                            }
+                                            catch (const nlohmann::json::exception &)
+                                            {
+                                                corrupt = true;
+                                                return nullptr;
+                                            }
+                                            return std::make_unique<CachedResponse>(CachedResponse{
+                                                std::move(response), stmt->columnText(3), stmt->columnText(4), stmt->columnInt(5)}); })
+                      .get();
+    // A row that no longer parses is a miss; drop it so the network response replaces it
+    if (corrupt)
+        state().executor.post([key](DATABASE &database)
+                              { database.remove("http_cache").where("key", key).execute(); });
+    return cached;
+}
+
+void ResponseCache::hit(const std::string &key)
+{
+    state().hits++;
+    int64_t usedAt = now();
+    state().executor.post([key, usedAt](DATABASE &database)
+                          { database.prepare("UPDATE http_cache SET last_used = ? WHERE key = ?")
+                                ->bind(1, usedAt)
+                                .bind(2, key)
+                                .step(); });
+}
+
+void ResponseCache::revalidated(const std::string &key, size_t ttl)
+{
+    state().revalidated++;
+    int64_t usedAt = now();
+    state().executor.post([key, usedAt, ttl](DATABASE &database)
+                          { database.prepare("UPDATE http_cache SET last_used = ?1, expires_at = ?1 + ?2 WHERE key = ?3")
+                                ->bind(1, usedAt)
+                                .bind(2, (int64_t)ttl)
+                                .bind(3, key)
+                                .step(); });
+}
+
+void ResponseCache::store(const std::string &key, const std::string &url, const Response &response, size_t ttl)
+{
+    state().misses++;
+    std::string cacheControl = header(response.headers, "Cache-Control");
+    if (response.status != 200 || cacheControl.find("no-store") != std::string::npos ||
+        (int64_t)response.body.size() > MAX_ENTRY_BYTES)
+        return;
+    // no-cache still allows storing, but every use has to be revalidated
+    if (cacheControl.find("no-cache") != std::string::npos)
+        ttl = 0;
+
+    std::string etag = header(response.headers, "ETag");
+    std::string lastModified = header(response.headers, "Last-Modified");
+    std::string headers = nlohmann::json(response.headers).dump();
+    std::string body = response.body;
+    int64_t storedAt = now();
+    state().executor.post([key, url, status = response.status, headers, body, etag, lastModified, storedAt, ttl](DATABASE &database)
+                          {
+                              database.insert("http_cache")
+                                  .value("key", key)
+                                  .value("url", url)
+                                  .value("status", status)
+                                  .value("headers", headers)
+                                  .value("body", body)
+                                  .value("etag", etag)
+                                  .value("last_modified", lastModified)
+                                  .value("expires_at", storedAt + (int64_t)ttl)
+                                  .value("size", (int64_t)(body.size() + headers.size()))
+                                  .value("last_used", storedAt)
+                                  .onConflict({"key"})
+                                  .doUpdate("url")
+                                  .doUpdate("status")
+                                  .doUpdate("headers")
+                                  .doUpdate("body")
+                                  .doUpdate("etag")
+                                  .doUpdate("last_modified")
+                                  .doUpdate("expires_at")
+                                  .doUpdate("size")
+                                  .doUpdate("last_used")
+                                  .execute();
+
+                              std::vector<std::string> evicted;
+                              int64_t total = 0;
+                              auto entries = database.prepare("SELECT key, size FROM http_cache ORDER BY last_used DESC");
+                              while (entries->step())
+                                  if ((total += entries->columnInt(1)) > MAX_BYTES)
+                                      evicted.push_back(entries->columnText(0));
+                              if (!evicted.empty())
+                                  database.remove("http_cache").whereIn("key", evicted).execute(); });
+}
+
+void ResponseCache::clear()
+{
+    state().executor.submit([](DATABASE &database)
+                            { database.remove("http_cache").execute(); })
+        .get();
+}
+
+ResponseCacheStats ResponseCache::stats()
+{
+    ResponseCacheStats stats;
+    stats.hits = state().hits;
+    stats.revalidated = state().revalidated;
+    stats.misses = state().misses;
+    auto totals = state().executor.read([](DATABASE &database)
+                                        {
+                                            auto stmt = database.prepare("SELECT COUNT(*), COALESCE(SUM(size), 0) FROM http_cache");
+                                            stmt->step();
+                                            return std::make_pair(stmt->columnInt(0), stmt->columnInt(1)); })
+                      .get();
+    stats.entries = totals.first;
+    stats.bytes = totals.second;
+    return stats;
+}
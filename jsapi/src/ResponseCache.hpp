@@ -0,0 +1,62 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "Fetch.hpp"
+
+struct CachedResponse
+{
+    Response response;
+    std::string etag, lastModified;
+    int64_t expiresAt;
+
+    bool fresh() const;
+};
+
+struct ResponseCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t revalidated = 0;
+    uint64_t misses = 0;
+    int64_t entries = 0;
+    int64_t bytes = 0;
+};
+
+// On-disk store for GET responses fetched with FetchOptions::cacheTtl. Entries are keyed
+// by URL and request headers and dropped least recently used first beyond MAX_BYTES.
+class ResponseCache
+{
+public:
+    static const int64_t MAX_BYTES = 2 * 1024 * 1024;
+    static const int64_t MAX_ENTRY_BYTES = 512 * 1024;
+
+    static std::string key(const std::string &url, const FetchOptions &options);
+    static std::unique_ptr<CachedResponse> lookup(const std::string &key, const std::string &url);
+
+    static void hit(const std::string &key);
+    // The server answered 304 Not Modified
+    static void revalidated(const std::string &key, size_t ttl);
+    // Records a full response; only 200s that allow storing are kept
+    static void store(const std::string &key, const std::string &url, const Response &response, size_t ttl);
+
+    static void clear();
+    static ResponseCacheStats stats();
+};
@@ -17,43 +17,58 @@
 
 #include "ScanInput.hpp"
 #include <unistd.h>
+#include <iostream>
 
-ScanInput::ScanInput() : database("/userdisk/database/history.db") {}
+ScanInput::ScanInput() : executor("/userdisk/database/history.db", DatabaseOptions::reader()) {}
 
 void ScanInput::initialize(ScanInputCallback callback)
 {
     if (initialized)
         return;
 
+    initialized = true;
     this->scanListenThread = std::make_unique<std::thread>(
         [this, callback]()
         {
-            std::string lastString = "";
+            // Only rows newer than the last one seen are fetched; the first
+            // poll just records where history currently ends. The timestamp is
+            // bound as an integer, since a TEXT parameter never compares greater
+            int64_t lastTimestamp = 0;
+            bool baseline = false, seen = false;
             while (this->initialized)
             {
-                auto historyData = database.select("table_history")
-                                       .select("word")
-                                       .order("timestamp", false)
-                                       .limit(1)
-                                       .execute();
-                if (historyData.size())
+                try
                 {
-                    std::string currentString = historyData[0]["word"];
-                    if (currentString != lastString)
+                    auto historyData = executor.read([lastTimestamp, seen](DATABASE &database)
+                                                     {
+                                                         SELECT query = database.select("table_history")
+                                                                            .select("word")
+                                                                            .select("timestamp")
+                                                                            .order("timestamp", false)
+                                                                            .limit(1);
+                                                         if (seen)
+                                                             (void)query.where("timestamp", SELECT::GT, lastTimestamp);
+                                                         return query.execute(); })
+                                           .get();
+                    if (historyData.size())
                     {
-                        if (lastString != "")
+                        lastTimestamp = std::stoll(historyData[0]["timestamp"]);
+                        seen = true;
+                        if (baseline)
                         {
                             system("miniapp_cli start 8001749644971193 softKeyboard");
-                            callback(currentString);
+                            callback(historyData[0]["word"]);
                         }
-                        lastString = currentString;
                     }
+                    baseline = true;
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Scan input poll error: " << e.what() << std::endl;
                 }
                 sleep(1);
             }
         });
-
-    initialized = true;
 }
 void ScanInput::deinitialize()
 {
@@ -18,7 +18,7 @@
 #pragma once
 
 #include <jqutil_v2/jqutil.h>
-#include "Database/Database.hpp"
+#include "Database/DatabaseExecutor.hpp"
 #include "ScanInputCallback.hpp"
 #include <string>
 #include <thread>
@@ -26,7 +26,7 @@
 class ScanInput
 {
 private:
-    DATABASE database;
+    DatabaseExecutor executor;
 
     std::unique_ptr<std::thread> scanListenThread;
     std::string lastString;
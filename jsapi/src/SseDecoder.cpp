@@ -0,0 +1,136 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "SseDecoder.hpp"
+#include <algorithm>
+
+SseDecoder::SseDecoder(SseCallback callback) : callback(std::move(callback)) {}
+
+void SseDecoder::feed(std::string_view chunk)
+{
+    // A UTF-8 byte order mark may open the stream and can itself be split across chunks
+    static const std::string_view byteOrderMark = "\xEF\xBB\xBF";
+    while (byteOrderMarkMatched < byteOrderMark.size() && !chunk.empty())
+    {
+        if (chunk.front() != byteOrderMark[byteOrderMarkMatched])
+        {
+            carry.append(byteOrderMark.substr(0, byteOrderMarkMatched));
+            byteOrderMarkMatched = byteOrderMark.size();
+            break;
+        }
+        chunk.remove_prefix(1);
+        byteOrderMarkMatched++;
+    }
+
+    if (skipLineFeed && !chunk.empty())
+    {
+        if (chunk.front() == '\n')
+            chunk.remove_prefix(1);
+        skipLineFeed = false;
+    }
+
+    while (!chunk.empty())
+    {
+        size_t end = chunk.find_first_of("\r\n");
+        if (end == std::string_view::npos)
+        {
+            carry.append(chunk);
+            return;
+        }
+
+        if (carry.empty())
+            processLine(chunk.substr(0, end));
+        else
+        {
+            carry.append(chunk.substr(0, end));
+            processLine(carry);
+            carry.clear();
+        }
+
+        if (chunk[end] == '\r')
+        {
+            if (end + 1 == chunk.size())
+                skipLineFeed = true;
+            else if (chunk[end + 1] == '\n')
+                end++;
+        }
+        chunk.remove_prefix(end + 1);
+    }
+}
+
+void SseDecoder::finish()
+{
+    if (!carry.empty())
+    {
+        std::string line;
+        line.swap(carry);
+        processLine(line);
+    }
+    dispatch();
+    skipLineFeed = false;
+}
+
+void SseDecoder::processLine(std::string_view line)
+{
+    if (line.empty())
+    {
+        dispatch();
+        return;
+    }
+    if (line.front() == ':')
+        return;
+
+    std::string_view field = line, value;
+    size_t colon = line.find(':');
+    if (colon != std::string_view::npos)
+    {
+        field = line.substr(0, colon);
+        value = line.substr(colon + 1);
+        if (!value.empty() && value.front() == ' ')
+            value.remove_prefix(1);
+    }
+
+    if (field == "data")
+        pending.data.append(value).push_back('\n');
+    else if (field == "event")
+        pending.event.assign(value);
+    else if (field == "id")
+    {
+        if (value.find('\0') == std::string_view::npos)
+            lastEventId.assign(value);
+    }
+    else if (field == "retry")
+    {
+        if (!value.empty() && value.size() <= 9 && std::all_of(value.begin(), value.end(), [](char c)
+                                          { return c >= '0' && c <= '9'; }))
+            pending.retry = std::stoi(std::string(value));
+    }
+}
+
+void SseDecoder::dispatch()
+{
+    if (pending.data.empty())
+    {
+        pending = SseEvent();
+        return;
+    }
+    pending.data.pop_back();
+    pending.id = lastEventId;
+    SseEvent event;
+    std::swap(event, pending);
+    callback(event);
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+struct SseEvent
+{
+    std::string event = "message";
+    std::string data;
+    std::string id;
+    int retry = -1;
+};
+
+using SseCallback = std::function<void(const SseEvent &event)>;
+
+// Incremental text/event-stream decoder. Chunks may split lines, CRLF pairs
+// and events at any byte; the unfinished line is carried over to the next
+// feed() and complete events are handed to the callback.
+class SseDecoder
+{
+private:
+    SseCallback callback;
+    std::string carry;
+    SseEvent pending;
+    std::string lastEventId;
+    size_t byteOrderMarkMatched = 0;
+    bool skipLineFeed = false;
+
+    void processLine(std::string_view line);
+    void dispatch();
+
+public:
+    explicit SseDecoder(SseCallback callback);
+
+    void feed(std::string_view chunk);
+    // Treats the end of the stream as a line and event terminator
+    void finish();
+};
@@ -0,0 +1,90 @@
+// Copyright (C) 2025 Langning Chen
+//
+// This file is part of miniapp.
+//
+// miniapp is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// miniapp is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with miniapp.  If not, see <https://www.gnu.org/licenses/>.
+
+// Feeds each stream whole, split at every pair of offsets and one byte at a
+// time; every way of splitting must produce the expected events.
+
+#include "SseDecoder.hpp"
+#include <iostream>
+#include <vector>
+
+static std::string decode(const std::string &stream, const std::vector<size_t> &cuts)
+{
+    std::string events;
+    SseDecoder decoder([&events](const SseEvent &event)
+                       { events += event.event + "|" + event.data + "|" + event.id + "|" + std::to_string(event.retry) + "\n"; });
+    size_t position = 0;
+    for (size_t cut : cuts)
+    {
+        decoder.feed(std::string_view(stream).substr(position, cut - position));
+        position = cut;
+    }
+    decoder.feed(std::string_view(stream).substr(position));
+    decoder.finish();
+    return events;
+}
+
+int main()
+{
+    // Each stream with its events as event|data|id|retry lines
+    const std::vector<std::pair<std::string, std::string>> streams = {
+        // Byte order mark, CRLF, bare CR, every field, a comment and [DONE]
+        {"\xEF\xBB\xBF"
+         "data: {\"a\":1}\r\n\r\ndata: x\rdata: y\r\revent: ping\nid: 7\nretry: 1500\ndata:z\n\n: comment\ndata: [DONE]\n\n",
+         "message|{\"a\":1}||-1\nmessage|x\ny||-1\nping|z|7|1500\nmessage|[DONE]|7|-1\n"},
+        // Last event terminated only by the end of the stream
+        {"data: a\n\ndata: b",
+         "message|a||-1\nmessage|b||-1\n"},
+        // An event without data is dropped; "data" alone is an empty line of data; only one leading space is stripped
+        {"event: e\n\ndata\n\ndata:  two\r\n\r\n",
+         "message|||-1\nmessage| two||-1\n"},
+        // A partial byte order mark stays part of the field name, so the line is ignored
+        {"\xEF\xBB"
+         "data: no bom\n\n",
+         ""},
+    };
+
+    int failures = 0;
+    for (const auto &[stream, expected] : streams)
+    {
+        if (decode(stream, {}) != expected)
+        {
+            std::cerr << "Unexpected events from:\n"
+                      << stream << std::endl;
+            failures++;
+        }
+        for (size_t i = 0; i <= stream.size(); i++)
+            for (size_t j = i; j <= stream.size(); j++)
+                if (decode(stream, {i, j}) != expected)
+                {
+                    std::cerr << "Split at " << i << " and " << j << " changed the events of:\n"
+                              << stream << std::endl;
+                    failures++;
+                }
+
+        std::vector<size_t> everyByte;
+        for (size_t i = 1; i < stream.size(); i++)
+            everyByte.push_back(i);
+        if (decode(stream, everyByte) != expected)
+        {
+            std::cerr << "Byte-by-byte feed changed the events of:\n"
+                      << stream << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
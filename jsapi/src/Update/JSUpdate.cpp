@@ -189,6 +189,8 @@ void JSUpdate::check(JQAsyncInfo& info) {
         options.headers["User-Agent"] = "miniapp-updater/1.0";
         options.headers["Accept"] = "application/vnd.github.v3+json";
         options.timeout = 30;
+        // 与 download 共用缓存，过期后用 ETag 重新验证
+        options.cacheTtl = 300;
         
         Response response = Fetch::fetch(url, options);
         
@@ -290,7 +292,10 @@ void JSUpdate::download(JQAsyncInfo& info) {
         
         FetchOptions checkOptions;
         checkOptions.headers["User-Agent"] = "miniapp-updater/1.0";
+        // 请求头与 check 保持一致，才能命中同一条缓存
+        checkOptions.headers["Accept"] = "application/vnd.github.v3+json";
         checkOptions.timeout = 30;
+        checkOptions.cacheTtl = 300;
         
         Response checkResponse = Fetch::fetch(checkUrl, checkOptions);
         
@@ -54,3 +54,16 @@ std::string strUtils::join(const std::vector<std::string> &vec, const std::strin
     }
     return result;
 }
+
+std::string strUtils::utf8Prefix(const std::string &str, size_t maxCharacters)
+{
+    size_t characters = 0, pos = 0;
+    while (pos < str.size())
+    {
+        // Continuation bytes (10xxxxxx) belong to the character before them
+        if (((unsigned char)str[pos] & 0xC0) != 0x80 && characters++ == maxCharacters)
+            break;
+        pos++;
+    }
+    return str.substr(0, pos);
+}
@@ -31,4 +31,5 @@ public:
 
     static std::vector<std::string> split(const std::string &str, const std::string &delimiter);
     static std::string join(const std::vector<std::string> &vec, const std::string &delimiter);
+    static std::string utf8Prefix(const std::string &str, size_t maxCharacters);
 };
@@ -18,10 +18,16 @@
 import * as langningchen from './langningchen';
 
 export declare class AI {
-    static initialize(): void;
+    static initialize(): Promise<void>;
     static getCurrentPath(): langningchen.ConversationNode[];
+    static getPathChanges(sinceVersion: number): langningchen.PathChanges;
     static getChildNodes(nodeId: string): string[];
-    static switchToNode(nodeId: string): void;
+    static switchToNode(nodeId: string): Promise<void>;
+    static switchToLeaf(nodeId: string, lastChild?: boolean): Promise<langningchen.BranchSwitchResult>;
+    static switchSibling(nodeId: string, offset: number): Promise<langningchen.BranchSwitchResult>;
+    static setPinned(nodeId: string, pinned: boolean): boolean;
+    static getBranch(): langningchen.BranchStep[];
+    static getSubtree(nodeId: string, maxDepth?: number): Promise<langningchen.SubtreeNode[]>;
     static getCurrentNodeId(): string;
     static getRootNodeId(): string;
     static getCurrentConversationId(): string;
@@ -29,17 +35,27 @@ export declare class AI {
     static addUserMessage(message: string): Promise<void>;
     static generateResponse(): Promise<string>;
     static stopGeneration(): void;
+    static setStreamCheckpoint(intervalMs: number, bytes: number): void;
+    static setStreamFrame(frameMs: number, frameBytes: number, maxPendingFrames: number): void;
+    static getStreamStats(): langningchen.StreamStats;
+    static setContextPolicy(maxPromptTokens: number, keepTurns: number): void;
+    static getContextReport(): langningchen.ContextReport;
     static getModels(): Promise<string[]>;
     static getUserBalance(): Promise<number>;
 
     static getConversationList(): Promise<langningchen.ConversationNode[]>;
+    static getConversationPage(limit: number, after?: langningchen.ConversationCursor): Promise<langningchen.ConversationPage>;
+    static searchMessages(query: string, limit?: number, cursor?: string): Promise<langningchen.SearchPage>;
     static createConversation(title?: string): Promise<void>;
     static loadConversation(conversationId: string): Promise<void>;
     static deleteConversation(conversationId: string): Promise<void>;
     static updateConversationTitle(conversationId: string, title: string): Promise<void>;
 
-    static setSettings(apiKey: string, baseUrl: string, modelName: string, maxTokens: number, temperature: number, topP: number, systemPrompt: string): void;
+    static setSettings(apiKey: string, baseUrl: string, modelName: string, maxTokens: number, temperature: number, topP: number, systemPrompt: string): Promise<void>;
     static getSettings(): langningchen.SettingsResponse;
+    static setFallbackEndpoints(endpoints: langningchen.AIEndpoint[]): Promise<void>;
+    static getFallbackEndpoints(): langningchen.AIEndpoint[];
+    static getEndpointHealth(): langningchen.EndpointHealth[];
 
     static on(event: 'ai_stream', callback: (data: string) => void): void;
 }
@@ -61,3 +77,35 @@ export declare class Shell {
     static initialize(): void;
     static exec(cmd: string): Promise<string>;
 }
+
+export declare class Diagnostics {
+    static setProfiling(enabled: boolean, slowThresholdMs?: number): void;
+    static getQueryStats(): langningchen.QueryStat[];
+    static getSlowQueries(): langningchen.SlowQuery[];
+    static resetQueryStats(): void;
+    static getConnectionStats(): langningchen.ConnectionStats;
+    static resetConnectionStats(): void;
+    static getResponseCacheStats(): Promise<langningchen.ResponseCacheStats>;
+    static clearResponseCache(): Promise<void>;
+    static getNetworkTimings(): langningchen.NetworkTimings;
+    static resetNetworkTimings(): void;
+
+    static backupDatabase(source: string, destination: string, pagesPerStep?: number): Promise<void>;
+    static getDatabaseStats(): Promise<langningchen.DatabaseStats[]>;
+    static on(event: 'backup_progress', callback: (data: langningchen.BackupProgress) => void): void;
+}
+
+export declare class Database {
+    static open(name: string, profile?: 'interactive' | 'bulk-load' | 'reader' | 'default'): Promise<number>;
+    static close(db: number): Promise<void>;
+    static exec(db: number, sql: string, params?: langningchen.SqlValue[]): Promise<langningchen.RunResult>;
+    static query(db: number, sql: string, params?: langningchen.SqlValue[]): Promise<langningchen.Row[]>;
+    static transaction(db: number, statements: [string, langningchen.SqlValue[]?][]): Promise<langningchen.RunResult[]>;
+
+    static prepare(db: number, sql: string): Promise<number>;
+    static run(stmt: number, params?: langningchen.SqlValue[]): Promise<langningchen.RunResult>;
+    static all(stmt: number, params?: langningchen.SqlValue[]): Promise<langningchen.Row[]>;
+    static iterate(stmt: number, params?: langningchen.SqlValue[]): Promise<langningchen.RowBatch>;
+    static next(stmt: number): Promise<langningchen.RowBatch>;
+    static finalize(stmt: number): void;
+}
@@ -38,14 +38,66 @@ export interface ConversationNode {
     parentId: string;
     childIds: string[];
     timestamp: string;
+    pinned: boolean;
     stopReason: STOP_REASON;
 }
 
+export interface PathChanges {
+    version: number;
+    reset: boolean;
+    path?: string[];
+    nodes: ConversationNode[];
+}
+
+export interface BranchStep {
+    id: string;
+    siblingIndex: number;
+    siblingCount: number;
+}
+
+export interface BranchSwitchResult {
+    switched: boolean;
+    currentNodeId: string;
+    branch: BranchStep[];
+}
+
+export interface SubtreeNode extends ConversationNode {
+    depth: number;
+}
+
 export interface ConversationInfo {
     id: string;
     title: string;
     createdAt: number;
     updatedAt: number;
+    messageCount: number;
+    lastSnippet: string;
+}
+
+export interface ConversationCursor {
+    updatedAt: string;
+    id: string;
+}
+
+export interface ConversationPage {
+    items: ConversationInfo[];
+    nextCursor?: ConversationCursor;
+}
+
+export interface SearchResult {
+    conversationId: string;
+    conversationTitle: string;
+    nodeId: string;
+    role: ROLE;
+    snippet: string;
+    rank: number;
+}
+
+export interface SearchPage {
+    items: SearchResult[];
+    // The short-keyword LIKE fallback stopped at its scan bound; nextCursor continues with older messages
+    partial: boolean;
+    nextCursor?: string;
 }
 
 
@@ -59,6 +111,35 @@ export interface SettingsResponse {
     systemPrompt: string;
 }
 
+export interface AIEndpoint {
+    baseUrl: string;
+    apiKey: string;
+}
+export interface EndpointHealth {
+    baseUrl: string;
+    requests: number;
+    failures: number;
+    latencyMs: number;
+    errorRate: number;
+    measured: boolean;
+    consecutiveFailures: number;
+    cooldownMs: number;
+}
+
+export interface StreamStats {
+    chunks: number;
+    bytes: number;
+    parseMicros: number;
+}
+
+export interface ContextReport {
+    totalMessages: number;
+    sentMessages: number;
+    totalTokens: number;
+    sentTokens: number;
+    requestBytes: number;
+}
+
 
 export type Pinyin = string[]
 export interface Candidate {
@@ -66,3 +147,117 @@ export interface Candidate {
     hanZi: string;
     freq: number;
 }
+
+export interface QueryStat {
+    database: string;
+    sql: string;
+    count: number;
+    rows: number;
+    totalMs: number;
+    maxMs: number;
+    avgMs: number;
+}
+export interface SlowQuery {
+    database: string;
+    sql: string;
+    ms: number;
+    timestamp: number;
+}
+export interface ConnectionStats {
+    requests: number;
+    newConnections: number;
+    reusedConnections: number;
+    reuseRate: number;
+    handshakeMs: number;
+    savedMs: number;
+    savedMsPerRequest: number;
+    idleHandles: number;
+}
+export interface ResponseCacheStats {
+    hits: number;
+    revalidated: number;
+    misses: number;
+    entries: number;
+    bytes: number;
+    maxBytes: number;
+}
+export interface TimingHistogram {
+    count: number;
+    avgMs: number;
+    maxMs: number;
+    p50Ms: number;
+    p90Ms: number;
+    buckets: number[];
+}
+export interface HostTiming {
+    host: string;
+    requests: number;
+    failures: number;
+    downloadBytes: number;
+    uploadBytes: number;
+    dns: TimingHistogram;
+    connect: TimingHistogram;
+    tls: TimingHistogram;
+    wait: TimingHistogram;
+    transfer: TimingHistogram;
+    total: TimingHistogram;
+    firstEvent: TimingHistogram;
+    eventGap: TimingHistogram;
+}
+export interface RequestTiming {
+    nameLookupMs: number;
+    connectMs: number;
+    appConnectMs: number;
+    startTransferMs: number;
+    totalMs: number;
+    downloadSpeed: number;
+    uploadSpeed: number;
+    downloadBytes: number;
+    uploadBytes: number;
+    headerBytes: number;
+    reusedConnection: boolean;
+    events: number;
+    firstEventMs: number;
+    maxEventGapMs: number;
+    avgEventGapMs: number;
+}
+export interface RecentRequest {
+    method: string;
+    host: string;
+    path: string;
+    status: number;
+    failed: boolean;
+    timestamp: number;
+    timing: RequestTiming;
+}
+export interface NetworkTimings {
+    bounds: number[];
+    hosts: HostTiming[];
+    recent: RecentRequest[];
+}
+export interface BackupProgress {
+    source: string;
+    remaining: number;
+    total: number;
+}
+export interface DatabaseStats {
+    database: string;
+    pageSize: number;
+    pageCount: number;
+    freelistCount: number;
+    fileSize: number;
+    walSize: number;
+    fragmentation: number;
+    autoVacuum: number;
+}
+
+export type SqlValue = null | boolean | number | string;
+export type Row = { [column: string]: null | number | string | ArrayBuffer };
+export interface RunResult {
+    changes: number;
+    lastInsertId: number;
+}
+export interface RowBatch {
+    rows: Row[];
+    done: boolean;
+}
@@ -40,6 +40,9 @@ const ai = defineComponent({
             streamingContent: '',
             isStreaming: false,
             messages: [] as ConversationNode[],
+            pathVersion: 0,
+            pathIds: [] as string[],
+            nodeCache: {} as Record<string, ConversationNode>,
             jumpToMessageId: '',
 
             currentConversationId: '',
@@ -53,9 +56,9 @@ const ai = defineComponent({
         this.$page.off("show", this.onPageShow);
     },
 
-    mounted() {
+    async mounted() {
         try {
-            AI.initialize();
+            await AI.initialize();
             this.aiInitialized = true;
             this.refreshMessages();
             AI.on('ai_stream', (data: string) => {
@@ -117,7 +120,13 @@ const ai = defineComponent({
 
         refreshMessages() {
             try {
-                this.messages = AI.getCurrentPath().map((node: ConversationNode) => ({ ...node, childIds: [...node.childIds] }));
+                const changes = AI.getPathChanges(this.pathVersion);
+                if (changes.reset) this.nodeCache = {};
+                for (const node of changes.nodes) this.nodeCache[node.id] = node;
+                if (changes.path) this.pathIds = changes.path;
+                this.pathVersion = changes.version;
+                this.messages = this.pathIds.map(id => this.nodeCache[id]).filter(node => node)
+                    .map((node: ConversationNode) => ({ ...node, childIds: [...node.childIds] }));
             } catch (e) {
                 showError(e as string || '获取消息失败');
             }
@@ -191,32 +200,33 @@ const ai = defineComponent({
         async regenerateMessage(messageId: string) {
             if (this.isStreaming) return;
             try {
-                AI.switchToNode(this.getMessage(messageId)!.parentId);
+                await AI.switchToNode(this.getMessage(messageId)!.parentId);
                 this.generateResponse();
             } catch (e) {
                 showError(e as string || '切换消息失败');
             }
         },
 
-        switchVariant(messageId: string, direction: number) {
+        async switchVariant(messageId: string, direction: number) {
             if (this.isStreaming) return;
-            const message = this.getMessage(messageId)!;
-            const parentMessage = this.getMessage(message.parentId);
-            if (!parentMessage) return;
-            const currentIndex = parentMessage.childIds.indexOf(messageId);
-            const newIndex = currentIndex + direction;
-            if (newIndex >= 0 && newIndex < parentMessage.childIds.length) {
-                try {
-                    let newId = parentMessage.childIds[newIndex];
-                    while (AI.getChildNodes(newId).length > 0) {
-                        newId = AI.getChildNodes(newId)[0];
-                    }
-                    AI.switchToNode(newId);
+            try {
+                if ((await AI.switchSibling(messageId, direction)).switched) {
                     this.refreshMessages();
                     this.$forceUpdate();
-                } catch (e) {
-                    showError(e as string || '切换消息失败');
                 }
+            } catch (e) {
+                showError(e as string || '切换消息失败');
+            }
+        },
+
+        togglePinned(message: ConversationNode) {
+            try {
+                if (AI.setPinned(message.id, !message.pinned)) {
+                    this.refreshMessages();
+                    this.$forceUpdate();
+                }
+            } catch (e) {
+                showError(e as string || '固定消息失败');
             }
         },
 
@@ -245,12 +255,11 @@ const ai = defineComponent({
                 () => message.content,
                 (newContent) => {
                     if (newContent.trim() !== message.content.trim()) {
-                        try {
-                            AI.switchToNode(message.parentId);
+                        AI.switchToNode(message.parentId).then(() => {
                             this.sendMessage(newContent);
-                        } catch (e) {
+                        }).catch((e) => {
                             showError(e as string || '编辑消息失败');
-                        }
+                        });
                     }
                 }
             );
@@ -21,23 +21,30 @@ import { showError, showSuccess } from '../../components/ToastMessage';
 import { hideLoading, showLoading } from '../../components/Loading';
 import { openSoftKeyboard } from '../../utils/softKeyboardUtils';
 import { formatTime } from '../../utils/timeUtils';
+import { ConversationCursor, ConversationInfo, ROLE, SearchResult } from '../../@types/langningchen';
 
 export type aiHistoryOptions = {};
 
+const PAGE_SIZE = 20;
+
 const aiHistory = defineComponent({
     data() {
         return {
             $page: {} as FalconPage<aiHistoryOptions>,
-            conversationList: [] as any[],
+            conversationList: [] as ConversationInfo[],
+            nextCursor: undefined as ConversationCursor | undefined,
             currentConversationId: '',
 
             searchKeyword: '',
+            searchResults: [] as SearchResult[],
+            searchCursor: undefined as string | undefined,
+            searchPartial: false,
         };
     },
 
     async mounted() {
         try {
-            AI.initialize()
+            await AI.initialize();
             await this.loadConversationList();
         } catch (e) {
             showError(e as string || 'AI 初始化失败');
@@ -45,15 +52,12 @@ const aiHistory = defineComponent({
     },
 
     computed: {
-        filteredConversations(): any[] {
+        filteredConversations(): ConversationInfo[] {
             let filtered = [...this.conversationList];
             if (this.searchKeyword) {
                 const keyword = this.searchKeyword.toLowerCase();
                 filtered = filtered.filter(conv => conv.title.toLowerCase().includes(keyword));
             }
-            filtered.sort((a, b) => {
-                return b.updatedAt - a.updatedAt;
-            });
             return filtered;
         }
     },
@@ -61,8 +65,9 @@ const aiHistory = defineComponent({
     methods: {
         async loadConversationList() {
             showLoading();
-            AI.getConversationList().then((list) => {
-                this.conversationList = list;
+            return AI.getConversationPage(PAGE_SIZE).then((page) => {
+                this.conversationList = page.items;
+                this.nextCursor = page.nextCursor;
                 this.currentConversationId = AI.getCurrentConversationId();
             }).catch((e) => {
                 showError(e as string || '加载对话列表失败');
@@ -71,6 +76,19 @@ const aiHistory = defineComponent({
             });
         },
 
+        loadMoreConversations() {
+            if (!this.nextCursor) return;
+            showLoading();
+            AI.getConversationPage(PAGE_SIZE, this.nextCursor).then((page) => {
+                this.conversationList = this.conversationList.concat(page.items);
+                this.nextCursor = page.nextCursor;
+            }).catch((e) => {
+                showError(e as string || '加载对话列表失败');
+            }).finally(() => {
+                hideLoading();
+            });
+        },
+
         async createConversation() {
             AI.createConversation(`新对话 ${Date.now()}`).then(() => {
                 return this.loadConversationList();
@@ -126,15 +144,54 @@ const aiHistory = defineComponent({
         editSearchKeyword() {
             openSoftKeyboard(
                 () => this.searchKeyword,
-                (value) => { this.searchKeyword = value; this.$forceUpdate(); }
+                (value) => {
+                    this.searchKeyword = value.trim();
+                    this.searchResults = [];
+                    this.searchCursor = undefined;
+                    this.searchPartial = false;
+                    if (this.searchKeyword) this.searchMessages();
+                    this.$forceUpdate();
+                }
             );
         },
 
         clearSearch() {
             this.searchKeyword = '';
+            this.searchResults = [];
+            this.searchCursor = undefined;
+            this.searchPartial = false;
             this.$forceUpdate();
         },
 
+        searchMessages() {
+            showLoading();
+            AI.searchMessages(this.searchKeyword, PAGE_SIZE, this.searchCursor).then((page) => {
+                this.searchResults = this.searchResults.concat(page.items);
+                this.searchCursor = page.nextCursor;
+                this.searchPartial = page.partial;
+            }).catch((e) => {
+                showError(e as string || '搜索消息失败');
+            }).finally(() => {
+                hideLoading();
+            });
+        },
+
+        openSearchResult(result: SearchResult) {
+            AI.loadConversation(result.conversationId).then(() => {
+                return AI.switchToLeaf(result.nodeId);
+            }).then(() => {
+                this.currentConversationId = result.conversationId;
+                $falcon.trigger<string>('jump', result.nodeId);
+                this.$page.finish();
+            }).catch((e) => {
+                showError(e as string || '加载对话失败');
+            });
+        },
+
+        roleName(role: ROLE): string {
+            return role === ROLE.ROLE_USER ? '我' : 'AI';
+        },
+
         formatTime,
     }
 });
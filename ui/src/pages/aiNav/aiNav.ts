@@ -32,7 +32,7 @@ export default defineComponent({
 
     async mounted() {
         try {
-            AI.initialize();
+            await AI.initialize();
             this.aiInitialized = true;
             this.messages = AI.getCurrentPath();
         } catch (e) {
@@ -17,6 +17,7 @@
 
 import { defineComponent } from 'vue';
 import { AI } from 'langningchen';
+import { AIEndpoint, EndpointHealth } from '../../@types/langningchen';
 import { showError, showSuccess } from '../../components/ToastMessage';
 import { hideLoading, showLoading } from '../../components/Loading';
 import { openSoftKeyboard } from '../../utils/softKeyboardUtils';
@@ -38,12 +39,15 @@ const aiSettings = defineComponent({
 
             userBalance: 0.0,
             availableModels: [] as string[],
+
+            fallbackEndpoints: [] as AIEndpoint[],
+            endpointHealth: [] as EndpointHealth[],
         };
     },
 
-    mounted() {
+    async mounted() {
         try {
-            AI.initialize();
+            await AI.initialize();
             this.loadSettings();
             this.refreshBalance();
             this.refreshModels();
@@ -63,6 +67,8 @@ const aiSettings = defineComponent({
                 this.topP = settings.topP;
                 this.maxTokens = settings.maxTokens;
                 this.systemPrompt = settings.systemPrompt;
+                this.fallbackEndpoints = AI.getFallbackEndpoints();
+                this.refreshEndpointHealth();
             } catch (e) {
                 showError(e as string || '加载设置失败');
             }
@@ -92,20 +98,70 @@ const aiSettings = defineComponent({
             });
         },
 
+        refreshEndpointHealth() {
+            try {
+                this.endpointHealth = AI.getEndpointHealth();
+            } catch (e) {
+                showError(e as string || '获取端点状态失败');
+            }
+        },
+
+        endpointStatus(baseUrl: string) {
+            const health = this.endpointHealth.find((item) => item.baseUrl === baseUrl);
+            if (!health || health.requests === 0) { return '未使用'; }
+            if (health.cooldownMs > 0) { return `冷却 ${Math.ceil(health.cooldownMs / 1000)}s`; }
+            const latency = health.measured ? `${Math.round(health.latencyMs)}ms` : '-';
+            return `${latency} 错误 ${Math.round(health.errorRate * 100)}%`;
+        },
+
+        addEndpoint() {
+            openSoftKeyboard(
+                () => '',
+                (value) => {
+                    const baseUrl = value.endsWith('/') ? value : value + "/";
+                    this.fallbackEndpoints.push({ baseUrl, apiKey: this.apiKey });
+                    this.$forceUpdate();
+                },
+                (value) => {
+                    if (!value.startsWith("http")) { return '基础 URL 需要以 http 或 https 开头'; }
+                }
+            );
+        },
+
+        editEndpointKey(index: number) {
+            openSoftKeyboard(
+                () => this.fallbackEndpoints[index].apiKey,
+                (value) => { this.fallbackEndpoints[index].apiKey = value; this.$forceUpdate(); }
+            );
+        },
+
+        removeEndpoint(index: number) {
+            this.fallbackEndpoints.splice(index, 1);
+            this.$forceUpdate();
+        },
+
         selectModel(model: string) {
             this.modelName = model;
             this.$forceUpdate();
         },
 
-        saveSettings() {
+        async saveSettings() {
             try {
-                AI.setSettings(this.apiKey, this.baseUrl,
+                await AI.setSettings(this.apiKey, this.baseUrl,
                     this.modelName, this.maxTokens,
                     this.temperature, this.topP, this.systemPrompt,);
-                showSuccess('设置已保存');
             } catch (e) {
                 showError(e as string || '保存设置失败');
+                return;
+            }
+            try {
+                await AI.setFallbackEndpoints(this.fallbackEndpoints);
+            } catch (e) {
+                showError(`保存备用端点失败: ${e}`);
+                return;
             }
+            showSuccess('设置已保存');
+            this.refreshEndpointHealth();
         },
 
         editApiKey() {